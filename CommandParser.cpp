@@ -1,28 +1,232 @@
 #include "CommandParser.hpp"
+#include "Predicate.hpp"
+#include "Export.hpp"
+#include "View.hpp"
+#include "Executor.hpp"
 #include <sstream>
 #include <iostream>
 #include <algorithm> // for std::transform
+#include <charconv>  // partition counts
 #include "fmt/xchar.h"
 
 
+// Case-insensitive prefix test that does not copy the input.
+static bool startsWithKeyword(std::string_view text, std::string_view keyword) {
+    if (text.size() < keyword.size()) return false;
+    for (size_t i = 0; i < keyword.size(); ++i) {
+        if (std::toupper(static_cast<unsigned char>(text[i])) != keyword[i]) return false;
+    }
+    return true;
+}
+
 // Identify which command type this input matches (case-insensitive)
 
 CommandType CommandParser::identifyCommand(const std::string& input) {
-    std::string upper = input;
-    std::transform(upper.begin(), upper.end(), upper.begin(), ::toupper);
-
-    if (upper.starts_with("CREATE_TABLE")) return CommandType::CREATE_TABLE;
-    if (upper.starts_with("INSERT INTO")) return CommandType::INSERT;
-    if (upper.starts_with("SELECT")) return CommandType::SELECT;
-    if (upper.starts_with("DROP_TABLE")) return CommandType::DROP_TABLE;
-    if (upper.starts_with("ALTER TABLE") || upper.starts_with("ALTER_TABLE")) return CommandType::ALTER_TABLE;
-    if (upper.starts_with("UPDATE")) return CommandType::UPDATE;
-    if (upper.starts_with("SAVE TO")) return CommandType::SAVE_TO;
-    if (upper.starts_with("LOAD_FROM")) return CommandType::LOAD_FROM;
+    if (startsWithKeyword(input, "CREATE_TABLE")) return CommandType::CREATE_TABLE;
+    if (startsWithKeyword(input, "INSERT INTO")) return CommandType::INSERT;
+    if (startsWithKeyword(input, "SELECT")) return CommandType::SELECT;
+    if (startsWithKeyword(input, "DROP_TABLE")) return CommandType::DROP_TABLE;
+    if (startsWithKeyword(input, "ALTER TABLE") || startsWithKeyword(input, "ALTER_TABLE")) return CommandType::ALTER_TABLE;
+    if (startsWithKeyword(input, "UPDATE")) return CommandType::UPDATE;
+    if (startsWithKeyword(input, "DELETE FROM")) return CommandType::DELETE_FROM;
+    if (startsWithKeyword(input, "SET ")) return CommandType::SET;
+    if (startsWithKeyword(input, "SHOW STATS")) return CommandType::SHOW_STATS;
+    if (startsWithKeyword(input, "SAVE TO")) return CommandType::SAVE_TO;
+    if (startsWithKeyword(input, "LOAD_FROM")) return CommandType::LOAD_FROM;
+    if (startsWithKeyword(input, "COPY ")) return CommandType::COPY;
+    if (startsWithKeyword(input, "SPILL TABLE")) return CommandType::SPILL;
+    if (startsWithKeyword(input, "CREATE MATERIALIZED VIEW")) return CommandType::CREATE_VIEW;
+    if (startsWithKeyword(input, "BATCH ")) return CommandType::BATCH;
+    if (startsWithKeyword(input, "DROP MATERIALIZED VIEW") || startsWithKeyword(input, "DROP VIEW")) return CommandType::DROP_VIEW;
 
     return CommandType::UNKNOWN;
 }
 
+// Human readable byte count, e.g. 1536 -> "1.5 KB".
+static std::string formatBytes(size_t bytes) {
+    if (bytes < 1024) return fmt::format("{} B", bytes);
+    if (bytes < 1024 * 1024) return fmt::format("{:.1f} KB", bytes / 1024.0);
+    if (bytes < 1024ull * 1024 * 1024) return fmt::format("{:.1f} MB", bytes / (1024.0 * 1024.0));
+    return fmt::format("{:.2f} GB", bytes / (1024.0 * 1024.0 * 1024.0));
+}
+
+// Parse a byte count with an optional K/M/G (or KB/MB/GB) suffix, e.g. "512MB".
+static size_t parseByteSize(std::string text) {
+    std::transform(text.begin(), text.end(), text.begin(), ::toupper);
+    if (text.ends_with("B") && text.size() > 1 && !std::isdigit(static_cast<unsigned char>(text[text.size() - 2]))) text.pop_back();
+    size_t multiplier = 1;
+    if (!text.empty() && (text.back() == 'K' || text.back() == 'M' || text.back() == 'G')) {
+        multiplier = text.back() == 'K' ? 1024ull : text.back() == 'M' ? 1024ull * 1024 : 1024ull * 1024 * 1024;
+        text.pop_back();
+    }
+    // std::stoull would accept a sign (and wrap "-5" around) or leading blanks, so require a digit first.
+    if (text.empty() || !std::isdigit(static_cast<unsigned char>(text.front()))) throw std::runtime_error("Invalid size: " + text);
+    size_t pos = 0;
+    unsigned long long value = 0;
+    try {
+        value = std::stoull(text, &pos);
+    } catch (const std::out_of_range&) {
+        throw std::runtime_error("Invalid size: " + text);
+    }
+    if (pos != text.size() || value > SIZE_MAX / multiplier) throw std::runtime_error("Invalid size: " + text);
+    return static_cast<size_t>(value) * multiplier;
+}
+
+static size_t printTableStats(const Table& table) {
+    TableMemoryStats stats = table.memoryStats();
+    fmt::println(" Table '{}': {} row(s) ({} live, {} deleted)", table.name, stats.rowCount, stats.liveRows, stats.deletedRows);
+    if (table.partitionColumn >= 0) {
+        fmt::println("   {:<20} : HASH({}) x {}", "Partitions", table.columns[table.partitionColumn].name, table.partitions.size());
+    }
+    for (size_t i = 0; i < table.columns.size(); ++i) {
+        fmt::println("   {:<20} : {}", table.columns[i].name, formatBytes(stats.columnBytes[i]));
+    }
+    fmt::println("   {:<20} : {}", "String heap", formatBytes(stats.stringHeapBytes));
+    fmt::println("   {:<20} : {}", "Row overhead", formatBytes(stats.rowOverheadBytes));
+    fmt::println("   {:<20} : {}", "Indexes", formatBytes(stats.indexBytes));
+    fmt::println("   {:<20} : {}", "Allocator (est.)", formatBytes(stats.allocatorOverheadBytes));
+    fmt::println("   {:<20} : {}", "Total", formatBytes(stats.totalBytes));
+    if (stats.pagedRows > 0) {
+        fmt::println("   {:<20} : {} row slot(s), {}", "On disk", stats.pagedRows, formatBytes(stats.diskBytes));
+    }
+    return stats.totalBytes;
+}
+
+// A SELECT statement (without INTO), first split into its parts, then resolved against its table.
+struct SelectQuery{
+  std::string tableName;
+  std::string columnList;                 // text between SELECT and FROM
+  std::string condition;                  // WHERE clause, empty if there is none
+  Table* table = nullptr;
+  std::vector<int> selectedIndex;
+  std::vector<std::string> selectedNames;
+  std::unique_ptr<Predicate> predicate;   // null without WHERE
+  };
+
+// Split "SELECT cols FROM table [WHERE ...]". Prints the error and returns false on bad syntax.
+static bool splitSelect(const std::string& query, SelectQuery& select) {
+    std::string upperQuery = query;
+    std::transform(upperQuery.begin(), upperQuery.end(), upperQuery.begin(), ::toupper);
+
+    size_t fromPos = upperQuery.find("FROM");
+    if (fromPos == std::string::npos) {
+        std::cerr << " SELECT syntax error: missing FROM.\n";
+        return false;
+    }
+
+    select.columnList = query.substr(7, fromPos - 7);
+    std::string afterFrom = query.substr(fromPos + 5);
+
+    size_t wherePos = upperQuery.find("WHERE");
+    if (wherePos != std::string::npos) {
+        select.tableName = afterFrom.substr(0, wherePos - fromPos - 6);
+        select.condition = query.substr(wherePos + 6);
+    } else {
+        select.tableName = afterFrom;
+    }
+    // Remove all whitespace characters from tableName (leading, trailing, and in-between)
+    select.tableName.erase(std::remove_if(select.tableName.begin(), select.tableName.end(), ::isspace), select.tableName.end());
+    return true;
+}
+
+// Resolve the column list and the WHERE clause against 'table'. Prints the error and returns false on failure.
+static bool resolveSelect(Table& table, SelectQuery& select) {
+    select.table = &table;
+    // * successfully find
+    if (select.columnList.find('*') != std::string::npos) {
+        for (size_t i = 0; i < table.columns.size(); ++i) {
+            select.selectedIndex.push_back(i);
+            select.selectedNames.push_back(table.columns[i].name);
+        }
+    } else {
+        std::istringstream stream(select.columnList);
+        std::string col;
+        while (std::getline(stream, col, ',')) {
+            col.erase(std::remove_if(col.begin(), col.end(), ::isspace), col.end());
+            bool found = false;
+            for (size_t i = 0; i < table.columns.size(); ++i) {
+                if (table.columns[i].name == col) {
+                    select.selectedIndex.push_back(i);
+                    select.selectedNames.push_back(col);
+                    found = true;
+                    break;
+                }
+            }
+            if (!found) {
+                std::cerr << " Column not found: " << col << "\n";
+                return false;
+            }
+        }
+    }
+
+    // Parse the WHERE clause once, then order its conjuncts using column statistics.
+    if (!select.condition.empty()) {
+        try {
+            select.predicate = parsePredicate(select.condition, table);
+            optimizePredicate(*select.predicate, table);
+        } catch (const std::exception& e) {
+            std::cerr << " WHERE error: " << e.what() << "\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+// Print the header and the selected columns of the given rows.
+static void printRows(const SelectQuery& select, const std::vector<RowRef>& rows) {
+    const Table& table = *select.table;
+    for (const auto& colName : select.selectedNames) {
+        fmt::print("{:<15}", colName);
+    }
+    fmt::print("\n");
+
+    size_t printed = 0;
+    for (RowRef ref : rows) {
+        if (++printed % morselRows == 0) CancellationToken::current().check();
+        PinnedRow row = table.rowAt(ref);
+        for (int index : select.selectedIndex) {
+            fmt::print("{:<15}", table.valueAt(*row, index));
+        }
+        fmt::print("\n");
+    }
+}
+
+// SELECT cols FROM view: prints the stored rows, without touching the base table.
+static void printView(const MaterializedView& view, const std::string& colPart) {
+    const auto& columns = view.columns();
+    std::vector<size_t> selected;
+    if (colPart.find('*') != std::string::npos && colPart.find('(') == std::string::npos) {
+        for (size_t i = 0; i < columns.size(); ++i) selected.push_back(i);
+    } else {
+        std::istringstream stream(colPart);
+        std::string col;
+        while (std::getline(stream, col, ',')) {
+            col.erase(std::remove_if(col.begin(), col.end(), ::isspace), col.end());
+            auto found = std::find_if(columns.begin(), columns.end(), [&](const ViewColumn& column) {
+                std::string name = column.name;
+                name.erase(std::remove_if(name.begin(), name.end(), ::isspace), name.end());
+                return name == col;
+            });
+            if (found == columns.end()) {
+                std::cerr << " Column not found: " << col << "\n";
+                return;
+            }
+            selected.push_back(found - columns.begin());
+        }
+    }
+
+    for (size_t index : selected) {
+        fmt::print("{:<15}", columns[index].name);
+    }
+    fmt::print("\n");
+    view.forEachRow([&](const std::vector<Value>& values) {
+        for (size_t index : selected) {
+            fmt::print("{:<15}", values[index]);
+        }
+        fmt::print("\n");
+    });
+}
+
 // Main command dispatcher
 
 void CommandParser::executeCommand(const std::string& input, Database& db) {
@@ -61,75 +265,87 @@ void CommandParser::executeCommand(const std::string& input, Database& db) {
                 // Ensure case-insensitive type handling
                 std::transform(type.begin(), type.end(), type.begin(), ::toupper);
 
-                if (type == "INT") columns.push_back({name, DataType::INT});
-                else if (type == "FLOAT") columns.push_back({name, DataType::FLOAT});
-                else if (type == "STRING") columns.push_back({name, DataType::STRING});
-                else if (type == "BOOLEAN" || type == "BOOL") columns.push_back({name, DataType::BOOL});
-                else std::cerr << " Unknown column type: " << type << "\n";
+                try {
+                    DataType dataType = parseDataType(type);
+                    columns.push_back({name, dataType, defaultValueFor(dataType), 0});
+                } catch (const std::exception& e) {
+                    std::cerr << " " << e.what() << "\n";
+                }
+            }
+
+            // Optional: PARTITION BY HASH(col) INTO n
+            std::string partitionColumn;
+            size_t partitionCount = 0;
+            std::string tail = input.substr(end + 1);
+            std::string upperTail = tail;
+            std::transform(upperTail.begin(), upperTail.end(), upperTail.begin(), ::toupper);
+            if (upperTail.find("PARTITION") != std::string::npos) {
+                size_t hashOpen = upperTail.find("HASH(");
+                size_t hashClose = upperTail.find(')', hashOpen == std::string::npos ? 0 : hashOpen);
+                size_t intoPos = upperTail.find("INTO", hashClose == std::string::npos ? 0 : hashClose);
+                if (hashOpen == std::string::npos || hashClose == std::string::npos || intoPos == std::string::npos) {
+                    std::cerr << " Syntax error. Use: PARTITION BY HASH(column) INTO n\n";
+                    return;
+                }
+                partitionColumn = tail.substr(hashOpen + 5, hashClose - hashOpen - 5);
+                partitionColumn.erase(std::remove_if(partitionColumn.begin(), partitionColumn.end(), ::isspace), partitionColumn.end());
+                std::string countText = tail.substr(intoPos + 4);
+                countText.erase(std::remove_if(countText.begin(), countText.end(), ::isspace), countText.end());
+                if (!countText.empty() && countText.back() == ';') countText.pop_back();
+                auto [countEnd, countError] = std::from_chars(countText.data(), countText.data() + countText.size(), partitionCount);
+                if (countText.empty() || countError != std::errc() || countEnd != countText.data() + countText.size() ||
+                    partitionCount == 0 || partitionCount > maxPartitions) {
+                    std::cerr << " Invalid partition count (expected 1 to " << maxPartitions << ").\n";
+                    return;
+                }
+            }
+
+            int partitionIndex = -1;
+            for (size_t i = 0; i < columns.size(); ++i) {
+                if (columns[i].name == partitionColumn) partitionIndex = static_cast<int>(i);
+            }
+            if (partitionCount > 0 && partitionIndex == -1) {
+                std::cerr << " Partition column not found: " << partitionColumn << "\n";
+                return;
             }
 
-            db.createTable(tableName, columns);
-            fmt::println(" Table '{}' created with {} columns:", tableName, columns.size());
-            for (const auto& col : columns) {
+            // The table is partitioned before it is registered, so a failure leaves no half-made table behind.
+            Table* created = nullptr;
+            try {
+                Table table;
+                table.name = tableName;
+                table.columns = std::move(columns);
+                if (partitionCount > 0) table.partitionBy(partitionIndex, partitionCount);
+                created = &db.addTable(std::move(table));
+            } catch (const std::exception& e) {
+                std::cerr << " Create error: " << e.what() << "\n";
+                return;
+            }
+            fmt::println(" Table '{}' created with {} columns:", created->name, created->columns.size());
+            for (const auto& col : created->columns) {
                 fmt::println("- {:<12} : {}", col.name, dataTypeToString(col.type));
             }
+            if (partitionCount > 0) {
+                fmt::println(" Partitioned by HASH({}) into {} partitions.", partitionColumn, partitionCount);
+            }
             break;
         }        // ========== INSERT INTO Students VALUES (...) ==========
         case CommandType::INSERT: {
-            std::istringstream stream(input);
-            std::string cmd, into, tableName;
-            stream >> cmd >> into >> tableName;
+            // The command is only viewed, never copied: tokens are slices of 'input'
+            // and each value is built once, then moved into the table.
+            std::string_view command = input;
+            std::string_view tableName = command.substr(std::min(command.size(), size_t{11})); // after "INSERT INTO"
+            tableName.remove_prefix(std::min(tableName.size(), tableName.find_first_not_of(" \t")));
+            tableName = tableName.substr(0, tableName.find_first_of(" \t"));
 
             // Extract values inside parentheses
-            size_t openParen = input.find('(');
-            size_t closeParen = input.find(')');
+            size_t openParen = command.find('(');
+            size_t closeParen = command.find(')');
             if (openParen == std::string::npos || closeParen == std::string::npos) {
                 std::cerr << " Syntax error in INSERT command.\n";
                 return;
             }
 
-            std::string raw = input.substr(openParen + 1, closeParen - openParen - 1);
-            std::vector<Value> values;
-            std::string current;
-            bool inQuotes = false;
-
-            // Split values safely (handles quoted strings)
-            for (char c : raw) {
-                if (c == '"') inQuotes = !inQuotes;
-                if (c == ',' && !inQuotes) {
-                    std::string trimmed;
-                    std::remove_copy_if(current.begin(), current.end(), std::back_inserter(trimmed), ::isspace);
-
-                    if (trimmed.front() == '"' && trimmed.back() == '"')
-                        values.push_back(trimmed.substr(1, trimmed.size() - 2));
-                    else if (trimmed == "true" || trimmed == "false")
-                        values.push_back(trimmed == "true");
-                    else if (trimmed.find('.') != std::string::npos)
-                        values.push_back(std::stof(trimmed));
-                    else
-                        values.push_back(std::stoi(trimmed));
-
-                    current.clear();
-                } else {
-                    current += c;
-                }
-            }
-
-            // Handle last value
-            if (!current.empty()) {
-                std::string trimmed;
-                std::remove_copy_if(current.begin(), current.end(), std::back_inserter(trimmed), ::isspace);
-
-                if (trimmed.front() == '"' && trimmed.back() == '"')
-                    values.push_back(trimmed.substr(1, trimmed.size() - 2));
-                else if (trimmed == "true" || trimmed == "false")
-                    values.push_back(trimmed == "true");
-                else if (trimmed.find('.') != std::string::npos)
-                    values.push_back(std::stof(trimmed));
-                else
-                    values.push_back(std::stoi(trimmed));
-            }
-
             // Locate target table
             Table* table = db.getTable(tableName);
             if (!table) {
@@ -137,9 +353,42 @@ void CommandParser::executeCommand(const std::string& input, Database& db) {
                 return;
             }
 
+            std::string_view raw = command.substr(openParen + 1, closeParen - openParen - 1);
+            std::vector<Value> values;
+            values.reserve(table->columns.size());
+
+            // Split values safely (handles quoted strings). Each literal is parsed as its column's
+            // type, so 5 goes into a DOUBLE column as 5.0 and a BIGINT column accepts values beyond 32 bits.
+            try {
+                bool inQuotes = false;
+                size_t tokenStart = 0;
+                for (size_t i = 0; i <= raw.size(); ++i) {
+                    if (i < raw.size() && raw[i] == '"') inQuotes = !inQuotes;
+                    if (i < raw.size() && (raw[i] != ',' || inQuotes)) continue;
+
+                    std::string_view token = raw.substr(tokenStart, i - tokenStart);
+                    tokenStart = i + 1;
+                    size_t first = token.find_first_not_of(" \t");
+                    token = first == std::string_view::npos ? std::string_view() : token.substr(first, token.find_last_not_of(" \t") - first + 1);
+                    if (i == raw.size() && token.empty() && !values.empty()) break; // trailing comma, as before
+
+                    if (values.size() == table->columns.size()) {
+                        throw std::runtime_error("Value count does not match column count.");
+                    }
+                    values.push_back(parseValue(token, table->columns[values.size()].type));
+                }
+                if (values.size() != table->columns.size()) {
+                    throw std::runtime_error("Value count does not match column count.");
+                }
+            } catch (const std::exception& e) {
+                std::cerr << " Insert error: " << e.what() << "\n";
+                return;
+            }
+
             // Insert row and handle duplicate key errors
             try {
-                table->addRow(values);
+                db.ensureMemoryFor(table->insertBytes(values));
+                table->addRow(std::move(values));
                 fmt::println(" Row inserted into '{}'.", tableName);
             } catch (const std::exception& e) {
                 std::cerr << " Insert error: " << e.what() << "\n";
@@ -174,147 +423,81 @@ void CommandParser::executeCommand(const std::string& input, Database& db) {
             std::string upperQuery = query;
             std::transform(upperQuery.begin(), upperQuery.end(), upperQuery.begin(), ::toupper);
 
-            size_t fromPos = upperQuery.find("FROM");
-            if (fromPos == std::string::npos) {
-                std::cerr << " SELECT syntax error: missing FROM.\n";
-                return;
-            }
-
-            std::string colPart = query.substr(7, fromPos - 7);
-            std::string afterFrom = query.substr(fromPos + 5);
-
-            std::string tableName;
-            std::string condition;
-
-            size_t wherePos = upperQuery.find("WHERE");
-            if (wherePos != std::string::npos) {
-                tableName = afterFrom.substr(0, wherePos - fromPos - 6);
-                condition = query.substr(wherePos + 6);
-            } else {
-                tableName = afterFrom;
-            }
-            // Remove all whitespace characters from tableName (leading, trailing, and in-between)
-            tableName.erase(std::remove_if(tableName.begin(), tableName.end(), ::isspace), tableName.end());
-
-            Table* table = db.getTable(tableName);
-            if (!table) {
-                std::cerr << " Table not found: " << tableName << "\n";
-                return;
-            }
-
-            std::vector<int> selectedIndex;
-            std::vector<std::string> selectedNames;
-            // * successfully find
-            if (colPart.find('*') != std::string::npos) {
-                for (size_t i = 0; i < table->columns.size(); ++i) {
-                    selectedIndex.push_back(i);
-                    selectedNames.push_back(table->columns[i].name);
+            // Optional trailing INTO "file" [FORMAT CSV | COLUMNAR]: the result goes to a file instead of the console.
+            std::string exportPath;
+            ExportFormat exportFormat = ExportFormat::CSV;
+            size_t intoPos = upperQuery.rfind(" INTO ");
+            if (intoPos != std::string::npos && upperQuery.find('"', intoPos) != std::string::npos &&
+                upperQuery.find_first_not_of(' ', intoPos + 6) == upperQuery.find('"', intoPos)) {
+                size_t quoteStart = query.find('"', intoPos);
+                size_t quoteEnd = query.find('"', quoteStart + 1);
+                if (quoteEnd == std::string::npos) {
+                    std::cerr << " SELECT syntax error. Use: SELECT ... INTO \"file\" FORMAT CSV|COLUMNAR;\n";
+                    return;
                 }
-            } else {
-                std::istringstream stream(colPart);
-                std::string col;
-                while (std::getline(stream, col, ',')) {
-                    col.erase(std::remove_if(col.begin(), col.end(), ::isspace), col.end());
-                    bool found = false;
-                    for (size_t i = 0; i < table->columns.size(); ++i) {
-                        if (table->columns[i].name == col) {
-                            selectedIndex.push_back(i);
-                            selectedNames.push_back(col);
-                            found = true;
-                            break;
-                        }
-                    }
-                    if (!found) {
-                        std::cerr << " Column not found: " << col << "\n";
+                exportPath = query.substr(quoteStart + 1, quoteEnd - quoteStart - 1);
+
+                std::istringstream formatStream(query.substr(quoteEnd + 1));
+                std::string formatKeyword, formatName;
+                formatStream >> formatKeyword >> formatName;
+                std::transform(formatKeyword.begin(), formatKeyword.end(), formatKeyword.begin(), ::toupper);
+                if (!formatKeyword.empty()) {
+                    try {
+                        if (formatKeyword != "FORMAT") throw std::runtime_error("expected FORMAT after the file name");
+                        exportFormat = parseExportFormat(formatName);
+                    } catch (const std::exception& e) {
+                        std::cerr << " SELECT syntax error: " << e.what() << "\n";
                         return;
                     }
                 }
+                query.erase(intoPos);
+                upperQuery.erase(intoPos);
             }
 
-            for (const auto& colName : selectedNames) {
-                fmt::print("{:<15}", colName);
-            }
-            fmt::print("\n");
-
-            for (const auto& row : table->rows) {
-                bool show = true;
-
-                if (!condition.empty()) {
-                    std::istringstream condStream(condition);
-                    std::string condCol, op, valueStr;
-                    condStream >> condCol >> op >> valueStr;
-
-                    int condIndex = -1;
-                    for (size_t i = 0; i < table->columns.size(); ++i) {
-                        if (table->columns[i].name == condCol) {
-                            condIndex = static_cast<int>(i);
-                            break;
-                        }
-                    }
+            SelectQuery select;
+            if (!splitSelect(query, select)) return;
 
-                    if (condIndex == -1) {
-                        std::cerr << " WHERE column not found: " << condCol << "\n";
-                        continue;
-                    }
-                    // WHERE BLOCK IMPLEMENTATION
-                    const Value& actual = row.values[condIndex];
-                    op.erase(std::remove_if(op.begin(), op.end(), ::isspace), op.end());
-                    if (std::holds_alternative<int>(actual)) {
-                        int val = std::get<int>(actual);
-                        int cmp = std::stoi(valueStr);
-                        if (op == "==") show = val == cmp;
-                        else if (op == "!=") show = val != cmp;
-                        else if (op == ">")  show = val > cmp;
-                        else if (op == "<")  show = val < cmp;
-                        else if (op == ">=") show = val >= cmp;
-                        else if (op == "<=") show = val <= cmp;
-                        else {
-                            std::cerr << " Unsupported operator: " << op << "\n";
-                        }
-                    } else if (std::holds_alternative<float>(actual)) {
-                        float val = std::get<float>(actual);
-                        float cmp = std::stof(valueStr);
-                        if (op == "==") show = val == cmp;
-                        else if (op == "!=") show = val != cmp;
-                        else if (op == ">")  show = val > cmp;
-                        else if (op == "<")  show = val < cmp;
-                        else if (op == ">=") show = val >= cmp;
-                        else if (op == "<=") show = val <= cmp;
-                        else {
-                            std::cerr << " Unsupported operator: " << op << "\n";
-                        }
-                    } else if (std::holds_alternative<std::string>(actual)) {
-                        std::string cmp = valueStr;
-                        if (cmp.front() == '"' && cmp.back() == '"') {
-                            cmp = cmp.substr(1, cmp.size() - 2);
-                        }
-                        show = std::get<std::string>(actual) == cmp;
-                    } else if (std::holds_alternative<bool>(actual)) {
-                        show = std::get<bool>(actual) == (valueStr == "true");
+            Table* table = db.getTable(select.tableName);
+            if (!table) {
+                if (MaterializedView* view = db.getView(select.tableName)) {
+                    if (!select.condition.empty() || !exportPath.empty()) {
+                        std::cerr << " SELECT error: WHERE and INTO are not supported on materialized views.\n";
+                        return;
                     }
+                    printView(*view, select.columnList);
+                    break;
                 }
-
-                if (show) {
-                    for (int index : selectedIndex) {
-                        std::visit([](const auto& val) {
-                            fmt::print("{:<15}", val);
-                        }, row.values[index]);
-                    }
-                    fmt::print("\n");
+                std::cerr << " Table not found: " << select.tableName << "\n";
+                return;
+            }
+            if (!resolveSelect(*table, select)) return;
+
+            if (!exportPath.empty()) {
+                try {
+                    size_t written = exportRows(*table, select.predicate.get(), select.selectedIndex, exportPath, exportFormat);
+                    fmt::println(" {} row(s) written to '{}' ({}).", written, exportPath,
+                                 exportFormat == ExportFormat::CSV ? "CSV" : "COLUMNAR");
+                } catch (const std::exception& e) {
+                    std::cerr << " Export error: " << e.what() << "\n";
                 }
+                break;
             }
 
+            printRows(select, findMatchingRows(select.predicate.get(), *table));
             break;
         }
-        // ========== ALTER TABLE Students ADD Gender BOOL ==========
+        // ========== ALTER TABLE Students ADD Gender BOOL [DEFAULT true] ==========
         case CommandType::ALTER_TABLE: {
             std::string cleanInput = input;
             if (!cleanInput.empty() && cleanInput.back() == ';') cleanInput.pop_back();
-            std::replace(cleanInput.begin(), cleanInput.end(), '_', ' ');
+            if (cleanInput.size() > 5 && cleanInput[5] == '_') cleanInput[5] = ' '; // ALTER_TABLE -> ALTER TABLE
 
             std::istringstream stream(cleanInput);
-            std::string alter, tableKeyword, tableName, addKeyword, columnName, typeStr;
-            stream >> alter >> tableKeyword >> tableName >> addKeyword >> columnName >> typeStr;
+            std::string alter, tableKeyword, tableName, addKeyword, columnName, typeStr, defaultKeyword, defaultStr;
+            stream >> alter >> tableKeyword >> tableName >> addKeyword >> columnName >> typeStr >> defaultKeyword;
+            std::getline(stream, defaultStr);
+            defaultStr.erase(0, defaultStr.find_first_not_of(" \t"));
+            defaultStr.erase(defaultStr.find_last_not_of(" \t") + 1);
 
             if (alter != "ALTER" && alter != "alter") return;
             if (tableKeyword != "TABLE" && tableKeyword != "table") return;
@@ -329,16 +512,25 @@ void CommandParser::executeCommand(const std::string& input, Database& db) {
             // like if user inputs int , inT , InT we will handle it well.
 
             DataType type;
-            if (typeStr == "INT") type = DataType::INT;
-            else if (typeStr == "FLOAT") type = DataType::FLOAT;
-            else if (typeStr == "STRING") type = DataType::STRING;
-            else if (typeStr == "BOOL" || typeStr == "BOOLEAN") type = DataType::BOOL;
-            else {
+            try {
+                type = parseDataType(typeStr);
+            } catch (...) {
                 std::cerr << " Invalid column type: " << typeStr << "\n";
                 return;
             }
 
-            t->addColumn(columnName, type);
+            // Only the schema changes here; existing rows pick up the default lazily.
+            try {
+                std::transform(defaultKeyword.begin(), defaultKeyword.end(), defaultKeyword.begin(), ::toupper);
+                if (defaultKeyword == "DEFAULT") {
+                    t->addColumn(columnName, type, parseValue(defaultStr, type));
+                } else {
+                    t->addColumn(columnName, type);
+                }
+            } catch (const std::exception& e) {
+                std::cerr << " Alter error: " << e.what() << "\n";
+                return;
+            }
             fmt::println(" Column '{}' added to table '{}'.", columnName, tableName);
             break;
         }
@@ -375,88 +567,278 @@ void CommandParser::executeCommand(const std::string& input, Database& db) {
                 newValueStr.erase(std::remove_if(newValueStr.begin(), newValueStr.end(), ::isspace), newValueStr.end());
             }
 
-            // Parse WHERE clause: condCol op condValueStr
-            std::string condCol, op, condValueStr;
-            {
-                std::istringstream condStream(whereClause);
-                condStream >> condCol >> op >> condValueStr;
-                condCol.erase(std::remove_if(condCol.begin(), condCol.end(), ::isspace), condCol.end());
-                condValueStr.erase(std::remove_if(condValueStr.begin(), condValueStr.end(), ::isspace), condValueStr.end());
-            }
-
             Table* table = db.getTable(tableName);
             if (!table) {
                 std::cerr << " Table not found: " << tableName << "\n";
                 return;
             }
 
-            int targetIndex = -1, condIndex = -1;
+            int targetIndex = -1;
             for (size_t i = 0; i < table->columns.size(); ++i) {
                 if (table->columns[i].name == targetCol) targetIndex = i;
-                if (table->columns[i].name == condCol) condIndex = i;
             }
 
-            if (targetIndex == -1 || condIndex == -1) {
+            if (targetIndex == -1) {
                 std::cerr << " Column not found.\n";
                 return;
             }
 
+            std::unique_ptr<Predicate> predicate;
+            try {
+                predicate = parsePredicate(whereClause, *table);
+                optimizePredicate(*predicate, *table);
+            } catch (const std::exception& e) {
+                std::cerr << " WHERE error: " << e.what() << "\n";
+                return;
+            }
+
             // Prepare value for SET
             Value newValue;
             const DataType& targetType = table->columns[targetIndex].type;
             try {
-                if (targetType == DataType::INT) newValue = std::stoi(newValueStr);
-                else if (targetType == DataType::FLOAT) newValue = std::stof(newValueStr);
-                else if (targetType == DataType::STRING) {
-                    if (newValueStr.front() == '"' && newValueStr.back() == '"')
-                        newValue = newValueStr.substr(1, newValueStr.size() - 2);
-                    else newValue = newValueStr;
-                } else if (targetType == DataType::BOOL) newValue = (newValueStr == "true");
+                newValue = parseValue(newValueStr, targetType);
             } catch (...) {
                 std::cerr << " Type mismatch in SET value.\n";
                 return;
             }
 
-            // Update matching rows
+            // Update matching rows. Each change is logged first, so an UPDATE that fails or
+            // is cancelled halfway is rolled back as a whole.
             int updatedCount = 0; // for display how many rows are updated.
-            for (auto& row : table->rows) {
-                const Value& actual = row.values[condIndex];
-                bool match = false;
-
-                // Match the actual row value with the WHERE condition
-                if (std::holds_alternative<int>(actual)) match = std::get<int>(actual) == std::stoi(condValueStr); // std::stoi -> string to an integer.
-                else if (std::holds_alternative<float>(actual)) match = std::get<float>(actual) == std::stof(condValueStr); // std::stof -> string to an float.
-                else if (std::holds_alternative<std::string>(actual)) {
-                    std::string cmp = condValueStr;
-                    if (cmp.front() == '"' && cmp.back() == '"')
-                        cmp = cmp.substr(1, cmp.size() - 2);
-                    match = std::get<std::string>(actual) == cmp;
-                } else if (std::holds_alternative<bool>(actual)) {
-                    match = std::get<bool>(actual) == (condValueStr == "true");
-                }
-
-                if (match) {
-                    row.values[targetIndex] = newValue;
+            int pkIndex = table->primaryKeyIndex();
+            UndoLog undo(*table);
+            try {
+                for (RowRef ref : findMatchingRows(predicate.get(), *table)) {
+                    if (updatedCount > 0 && updatedCount % morselRows == 0) CancellationToken::current().check();
+                    Value oldValue, keyAfter;
+                    {
+                        PinnedRow row = table->rowAt(ref);
+                        oldValue = table->valueAt(*row, targetIndex);
+                        keyAfter = targetIndex == pkIndex ? newValue : table->valueAt(*row, pkIndex);
+                    }
+                    table->updateValue(ref, targetIndex, newValue);
+                    undo.recordUpdate(keyAfter, targetIndex, oldValue);
                     updatedCount++;
                 }
+            } catch (const std::exception& e) {
+                size_t restored = undo.rollback();
+                std::cerr << " Update error: " << e.what() << " (" << restored << " row(s) rolled back)\n";
+                return;
             }
 
             fmt::println(" {} row(s) updated in '{}'.", updatedCount, tableName);
             break;
         }
 
+        //  DELETE FROM Students WHERE Name == "Selim"
+        case CommandType::DELETE_FROM: {
+            std::string cleanInput = input;
+            if (!cleanInput.empty() && cleanInput.back() == ';') cleanInput.pop_back();
+
+            std::string upperInput = cleanInput;
+            std::transform(upperInput.begin(), upperInput.end(), upperInput.begin(), ::toupper);
+
+            // Without WHERE every row is deleted, like in SQL.
+            size_t wherePos = upperInput.find("WHERE", 12);
+            std::string tableName = cleanInput.size() > 12
+                ? cleanInput.substr(12, wherePos == std::string::npos ? std::string::npos : wherePos - 12)
+                : "";
+            tableName.erase(std::remove_if(tableName.begin(), tableName.end(), ::isspace), tableName.end());
+            if (tableName.empty()) {
+                std::cerr << " DELETE syntax error. Use: DELETE FROM table [WHERE condition];\n";
+                return;
+            }
+
+            Table* table = db.getTable(tableName);
+            if (!table) {
+                std::cerr << " Table not found: " << tableName << "\n";
+                return;
+            }
+
+            std::unique_ptr<Predicate> predicate;
+            if (wherePos != std::string::npos) {
+                try {
+                    predicate = parsePredicate(cleanInput.substr(wherePos + 6), *table);
+                    optimizePredicate(*predicate, *table);
+                } catch (const std::exception& e) {
+                    std::cerr << " WHERE error: " << e.what() << "\n";
+                    return;
+                }
+            }
+
+            // Rows are only tombstoned here; runMaintenance() reclaims the space later.
+            // A cancelled DELETE clears the tombstones it set again.
+            int deletedCount = 0;
+            UndoLog undo(*table);
+            try {
+                for (RowRef ref : findMatchingRows(predicate.get(), *table)) {
+                    if (deletedCount > 0 && deletedCount % morselRows == 0) CancellationToken::current().check();
+                    table->deleteRow(ref);
+                    undo.recordDelete(ref);
+                    deletedCount++;
+                }
+            } catch (const std::exception& e) {
+                size_t restored = undo.rollback();
+                std::cerr << " Delete error: " << e.what() << " (" << restored << " row(s) restored)\n";
+                return;
+            }
+
+            fmt::println(" {} row(s) deleted from '{}'.", deletedCount, tableName);
+            break;
+        }
+
+        //  SET compaction_threshold = 0.25
+        case CommandType::SET: {
+            std::string cleanInput = input;
+            if (!cleanInput.empty() && cleanInput.back() == ';') cleanInput.pop_back();
+
+            size_t eqPos = cleanInput.find('=');
+            if (eqPos == std::string::npos) {
+                std::cerr << " SET syntax error. Use: SET name = value;\n";
+                return;
+            }
+            std::string name = cleanInput.substr(4, eqPos - 4);
+            std::string valueStr = cleanInput.substr(eqPos + 1);
+            name.erase(std::remove_if(name.begin(), name.end(), ::isspace), name.end());
+            valueStr.erase(std::remove_if(valueStr.begin(), valueStr.end(), ::isspace), valueStr.end());
+            std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+
+            try {
+                if (name == "compaction_threshold") {
+                    double threshold = std::stod(valueStr);
+                    if (threshold < 0.0 || threshold > 1.0) {
+                        std::cerr << " compaction_threshold must be between 0 and 1.\n";
+                        return;
+                    }
+                    db.compactionThreshold = threshold;
+                } else if (name == "memory_budget") {
+                    db.memoryBudget = parseByteSize(valueStr); // 0 disables the budget
+                } else if (name == "statement_timeout") {
+                    // milliseconds, optionally with an ms or s suffix; 0 disables the timeout
+                    std::transform(valueStr.begin(), valueStr.end(), valueStr.begin(), ::tolower);
+                    long long scale = 1;
+                    if (valueStr.ends_with("ms")) valueStr.resize(valueStr.size() - 2);
+                    else if (valueStr.ends_with("s")) { valueStr.pop_back(); scale = 1000; }
+                    size_t pos = 0;
+                    long long ms = std::stoll(valueStr, &pos);
+                    if (pos != valueStr.size() || ms < 0) throw std::runtime_error("Invalid timeout");
+                    db.statementTimeout = std::chrono::milliseconds(ms * scale);
+                } else if (name == "buffer_pool") {
+                    BufferPool::instance().setBudget(parseByteSize(valueStr));
+                } else if (name == "spill_directory") {
+                    valueStr.erase(std::remove(valueStr.begin(), valueStr.end(), '"'), valueStr.end());
+                    db.spillDirectory = valueStr; // empty = a directory under the system temp path
+                } else {
+                    std::cerr << " Unknown setting: " << name << "\n";
+                    return;
+                }
+            } catch (...) {
+                std::cerr << " Invalid value for " << name << ": " << valueStr << "\n";
+                return;
+            }
+            fmt::println(" {} = {}", name, valueStr);
+            break;
+        }
+
+        // SHOW STATS [table]
+        case CommandType::SHOW_STATS: {
+            std::string cleanInput = input;
+            if (!cleanInput.empty() && cleanInput.back() == ';') cleanInput.pop_back();
+            std::string tableName = cleanInput.substr(10);
+            tableName.erase(std::remove_if(tableName.begin(), tableName.end(), ::isspace), tableName.end());
+
+            if (!tableName.empty()) {
+                Table* table = db.getTable(tableName);
+                if (!table) {
+                    std::cerr << " Table not found: " << tableName << "\n";
+                    return;
+                }
+                printTableStats(*table);
+                break;
+            }
+
+            size_t total = 0;
+            for (auto& table : db.tables) {
+                total += printTableStats(table);
+                table.resyncTrackedBytes(); // refresh the budget estimate while we are at it
+            }
+            for (const auto& view : db.views) {
+                fmt::println(" View '{}': {} row(s), maintained from '{}'", view->name(), view->rowCount(), view->baseTable());
+            }
+            fmt::println(" Database total: {} in {} table(s)", formatBytes(total), db.tables.size());
+            if (db.memoryBudget > 0) {
+                fmt::println(" Memory budget : {} ({:.1f}% used)", formatBytes(db.memoryBudget), 100.0 * total / db.memoryBudget);
+            }
+            BufferPool& pool = BufferPool::instance();
+            fmt::println(" Buffer pool   : {} of {} ({} hits, {} misses, {} evictions)", formatBytes(pool.residentBytes()),
+                         formatBytes(pool.budget()), pool.hits.load(), pool.misses.load(), pool.evictions.load());
+            break;
+        }
+
+        // SPILL TABLE Cars - move the table's in-memory rows to page files
+        case CommandType::SPILL: {
+            std::string cleanInput = input;
+            if (!cleanInput.empty() && cleanInput.back() == ';') cleanInput.pop_back();
+            std::string tableName = cleanInput.substr(11);
+            tableName.erase(std::remove_if(tableName.begin(), tableName.end(), ::isspace), tableName.end());
+
+            Table* table = db.getTable(tableName);
+            if (!table) {
+                std::cerr << " Table not found: " << tableName << "\n";
+                return;
+            }
+            try {
+                size_t written = table->spill(db.spillPath());
+                fmt::println(" {} row(s) of '{}' moved to disk ({} on disk in total).", written, tableName, table->pagedRowCount());
+            } catch (const std::exception& e) {
+                std::cerr << " Spill error: " << e.what() << "\n";
+            }
+            break;
+        }
+
+        // SAVE TO "file.db" [ASYNC | EVERY seconds]
         case CommandType::SAVE_TO: {
             size_t quoteStart = input.find('"');
             size_t quoteEnd = input.rfind('"');
             if (quoteStart == std::string::npos || quoteEnd == std::string::npos || quoteEnd <= quoteStart) {
-                std::cerr << " SAVE TO syntax error. Use: SAVE TO \"filename.db\";\n";
+                std::cerr << " SAVE TO syntax error. Use: SAVE TO \"filename.db\" [ASYNC | EVERY seconds];\n";
                 return;
             }
                     // Extract the text between quotation marks (e.g., "file.txt" → file.txt)
             std::string path = input.substr(quoteStart + 1, quoteEnd - quoteStart - 1);
+
+            std::string options = input.substr(quoteEnd + 1);
+            if (!options.empty() && options.back() == ';') options.pop_back();
+            std::transform(options.begin(), options.end(), options.begin(), ::toupper);
+            std::istringstream optionStream(options);
+            std::string mode;
+            optionStream >> mode;
+
             try {
-                db.saveToFile(path);
-                fmt::println(" Database saved to '{}'.", path);
+                if (mode == "ASYNC") {
+                    db.saveToFileAsync(path);
+                    fmt::println(" Snapshot to '{}' started in the background.", path);
+                } else if (mode == "EVERY") {
+                    int seconds = -1;
+                    std::string trailing;
+                    optionStream >> seconds;
+                    if (optionStream.fail() || seconds < 0 || optionStream >> trailing) {
+                        std::cerr << " SAVE TO ... EVERY expects a number of seconds.\n";
+                        return;
+                    }
+                    db.autoSnapshotPath = seconds > 0 ? path : "";
+                    db.autoSnapshotSeconds = seconds;
+                    db.lastAutoSnapshot = std::chrono::steady_clock::now();
+                    if (seconds > 0) fmt::println(" Snapshots to '{}' every {} second(s).", path, seconds);
+                    else fmt::println(" Periodic snapshots disabled.");
+                } else if (mode.empty()) {
+                    // A snapshot still writing would otherwise replace this newer save when it finishes.
+                    db.waitForSnapshot();
+                    db.saveToFile(path);
+                    fmt::println(" Database saved to '{}'.", path);
+                } else {
+                    std::cerr << " Unknown SAVE TO option: " << mode << "\n";
+                }
             } catch (const std::exception& e) {
                 std::cerr << " Save error: " << e.what() << "\n";
             }
@@ -472,14 +854,195 @@ void CommandParser::executeCommand(const std::string& input, Database& db) {
 
             std::string path = input.substr(quoteStart + 1, quoteEnd - quoteStart - 1);
             try {
-                db.loadFromFile(path);
-                fmt::println(" Database loaded from '{}'.", path);
+                if (isColumnarFile(path)) {
+                    // A columnar export holds one table: it is added, or replaces the table of the same name.
+                    Table loaded = readColumnarFile(path);
+                    std::string name = loaded.name;
+                    size_t rows = loaded.rowCount();
+                    db.ensureMemoryFor(loaded.trackedBytes());
+                    if (Table* existing = db.getTable(name)) {
+                        *existing = std::move(loaded);
+                        db.attachViews(*existing); // views over the old table are rebuilt from the new rows
+                    } else {
+                        db.addTable(std::move(loaded));
+                    }
+                    fmt::println(" Table '{}' loaded from '{}' ({} rows).", name, path, rows);
+                } else {
+                    db.loadFromFile(path);
+                    fmt::println(" Database loaded from '{}'.", path);
+                }
             } catch (const std::exception& e) {
                 std::cerr << " Load error: " << e.what() << "\n";
             }
             break;
         }
 
+        // COPY Cars FROM "cars.col" - append a columnar export to a table (created if missing)
+        case CommandType::COPY: {
+            std::string cleanInput = input;
+            if (!cleanInput.empty() && cleanInput.back() == ';') cleanInput.pop_back();
+
+            std::istringstream stream(cleanInput);
+            std::string copyKeyword, tableName, fromKeyword;
+            stream >> copyKeyword >> tableName >> fromKeyword;
+            std::transform(fromKeyword.begin(), fromKeyword.end(), fromKeyword.begin(), ::toupper);
+            size_t quoteStart = cleanInput.find('"');
+            size_t quoteEnd = cleanInput.rfind('"');
+            if (fromKeyword != "FROM" || quoteStart == std::string::npos || quoteEnd <= quoteStart) {
+                std::cerr << " COPY syntax error. Use: COPY table FROM \"file\";\n";
+                return;
+            }
+            std::string path = cleanInput.substr(quoteStart + 1, quoteEnd - quoteStart - 1);
+
+            size_t copied = 0;
+            try {
+                if (!isColumnarFile(path)) {
+                    throw std::runtime_error("'" + path + "' is not a columnar export (use SELECT ... INTO \"file\" FORMAT COLUMNAR)");
+                }
+                Table loaded = readColumnarFile(path);
+                db.ensureMemoryFor(loaded.trackedBytes());
+
+                Table* table = db.getTable(tableName);
+                if (!table) {
+                    loaded.name = tableName;
+                    copied = loaded.rowCount();
+                    db.addTable(std::move(loaded));
+                    fmt::println(" Table '{}' created from '{}' with {} row(s).", tableName, path, copied);
+                    break;
+                }
+
+                if (loaded.columns.size() != table->columns.size()) {
+                    throw std::runtime_error("column count does not match table '" + tableName + "'");
+                }
+                for (size_t i = 0; i < loaded.columns.size(); ++i) {
+                    if (loaded.columns[i].type != table->columns[i].type) {
+                        throw std::runtime_error("type of column '" + loaded.columns[i].name + "' does not match table '" + tableName + "'");
+                    }
+                }
+                copied = table->appendRows(loaded.partitions[0]->rows); // all or nothing
+            } catch (const std::exception& e) {
+                std::cerr << " Copy error: " << e.what() << " (no rows copied)\n";
+                return;
+            }
+            fmt::println(" {} row(s) copied into '{}'.", copied, tableName);
+            break;
+        }
+
+
+        // CREATE MATERIALIZED VIEW BrandPrices AS SELECT Brand, COUNT(*), AVG(Price) FROM Cars GROUP BY Brand
+        case CommandType::CREATE_VIEW: {
+            std::string cleanInput = input;
+            if (!cleanInput.empty() && cleanInput.back() == ';') cleanInput.pop_back();
+
+            std::istringstream stream(cleanInput.substr(24)); // after "CREATE MATERIALIZED VIEW"
+            std::string viewName, asKeyword;
+            stream >> viewName >> asKeyword;
+            std::transform(asKeyword.begin(), asKeyword.end(), asKeyword.begin(), ::toupper);
+            std::string select;
+            std::getline(stream, select);
+            select.erase(0, select.find_first_not_of(" \t"));
+            if (viewName.empty() || asKeyword != "AS" || select.empty()) {
+                std::cerr << " CREATE MATERIALIZED VIEW syntax error. Use: CREATE MATERIALIZED VIEW name AS SELECT ...;\n";
+                return;
+            }
+
+            try {
+                MaterializedView& view = db.createView(viewName, select);
+                fmt::println(" Materialized view '{}' created with {} row(s).", view.name(), view.rowCount());
+            } catch (const std::exception& e) {
+                std::cerr << " View error: " << e.what() << "\n";
+            }
+            break;
+        }
+
+        // DROP VIEW BrandPrices (or DROP MATERIALIZED VIEW BrandPrices)
+        case CommandType::DROP_VIEW: {
+            std::string cleanInput = input;
+            if (!cleanInput.empty() && cleanInput.back() == ';') cleanInput.pop_back();
+            std::string upperInput = cleanInput;
+            std::transform(upperInput.begin(), upperInput.end(), upperInput.begin(), ::toupper);
+            std::string viewName = cleanInput.substr(upperInput.find("VIEW") + 4);
+            viewName.erase(std::remove_if(viewName.begin(), viewName.end(), ::isspace), viewName.end());
+
+            try {
+                db.dropView(viewName);
+                fmt::println(" View '{}' dropped.", viewName);
+            } catch (const std::exception& e) {
+                std::cerr << " Drop error: " << e.what() << "\n";
+            }
+            break;
+        }
+
+        // BATCH SELECT * FROM Cars WHERE Price > 50000; SELECT Brand FROM Cars WHERE Electric == true;
+        // All queries on the same table are answered by one shared scan of it.
+        case CommandType::BATCH: {
+            std::vector<std::string> texts;
+            bool inQuotes = false;
+            size_t start = 6; // after "BATCH "
+            for (size_t i = start; i <= input.size(); ++i) {
+                if (i < input.size() && input[i] == '"') inQuotes = !inQuotes;
+                if (i < input.size() && (input[i] != ';' || inQuotes)) continue;
+                std::string text = input.substr(start, i - start);
+                text.erase(0, text.find_first_not_of(" \t"));
+                text.erase(text.find_last_not_of(" \t") + 1);
+                if (!text.empty()) texts.push_back(std::move(text));
+                start = i + 1;
+            }
+            if (texts.empty()) {
+                std::cerr << " BATCH syntax error. Use: BATCH SELECT ...; SELECT ...;\n";
+                return;
+            }
+
+            // Parse everything first: one bad query rejects the whole batch before any scan starts.
+            std::vector<SelectQuery> queries(texts.size());
+            for (size_t i = 0; i < texts.size(); ++i) {
+                if (identifyCommand(texts[i]) != CommandType::SELECT) {
+                    std::cerr << " BATCH error: only SELECT statements can be batched: " << texts[i] << "\n";
+                    return;
+                }
+                std::string upperText = texts[i];
+                std::transform(upperText.begin(), upperText.end(), upperText.begin(), ::toupper);
+                if (upperText.find(" INTO ") != std::string::npos) {
+                    std::cerr << " BATCH error: INTO is not supported in a batch.\n";
+                    return;
+                }
+                if (!splitSelect(texts[i], queries[i])) return;
+                Table* table = db.getTable(queries[i].tableName);
+                if (!table) {
+                    std::cerr << " Table not found: " << queries[i].tableName << "\n";
+                    return;
+                }
+                if (!resolveSelect(*table, queries[i])) return;
+            }
+
+            // One shared scan per distinct table.
+            std::vector<std::vector<RowRef>> results(queries.size());
+            std::vector<Table*> scanned;
+            for (size_t i = 0; i < queries.size(); ++i) {
+                Table* table = queries[i].table;
+                if (std::find(scanned.begin(), scanned.end(), table) != scanned.end()) continue;
+                scanned.push_back(table);
+
+                std::vector<size_t> members;
+                std::vector<const Predicate*> predicates;
+                for (size_t j = i; j < queries.size(); ++j) {
+                    if (queries[j].table != table) continue;
+                    members.push_back(j);
+                    predicates.push_back(queries[j].predicate.get());
+                }
+                std::vector<std::vector<RowRef>> shared = findMatchingRowsShared(predicates, *table);
+                for (size_t k = 0; k < members.size(); ++k) {
+                    results[members[k]] = std::move(shared[k]);
+                }
+            }
+
+            for (size_t i = 0; i < queries.size(); ++i) {
+                fmt::println(" [{}] {}", i + 1, texts[i]);
+                printRows(queries[i], results[i]);
+            }
+            fmt::println(" {} quer{} answered with {} shared scan(s).", queries.size(), queries.size() == 1 ? "y" : "ies", scanned.size());
+            break;
+        }
 
         // ========== UNKNOWN ==========
         case CommandType::UNKNOWN: {
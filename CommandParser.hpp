@@ -17,8 +17,16 @@ enum class CommandType{
   DROP_TABLE,
   ALTER_TABLE,
   UPDATE,
+  DELETE_FROM,
+  SET,
+  SHOW_STATS,
   SAVE_TO,
   LOAD_FROM,
+  COPY,
+  SPILL,
+  CREATE_VIEW,
+  DROP_VIEW,
+  BATCH,
   UNKNOWN
 };
 
@@ -0,0 +1,85 @@
+//
+// Statement execution: a worker thread runs one statement at a time under a cancellation token.
+//
+
+#include "Executor.hpp"
+#include <csignal>
+
+static_assert(std::atomic<CancellationToken::Reason>::is_always_lock_free, "cancel() is called from a signal handler");
+
+CancellationToken& CancellationToken::current() {
+    static CancellationToken token;
+    return token;
+}
+
+void CancellationToken::check() const {
+    switch (reason_.load(std::memory_order_relaxed)) {
+        case Reason::NONE: return;
+        case Reason::USER: throw StatementCancelled("statement cancelled by user (Ctrl-C)");
+        case Reason::TIMEOUT: throw StatementCancelled("statement cancelled: statement_timeout reached");
+    }
+}
+
+StatementExecutor::StatementExecutor() : worker_([this] { workerLoop(); }) {}
+
+StatementExecutor::~StatementExecutor() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_one();
+    worker_.join();
+}
+
+void StatementExecutor::workerLoop() {
+    while (true) {
+        std::packaged_task<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+            if (queue_.empty()) return; // stopping, nothing left to run
+            task = std::move(queue_.front());
+            queue_.pop_front();
+        }
+        task();
+    }
+}
+
+void StatementExecutor::run(std::function<void()> statement, std::chrono::milliseconds timeout) {
+    CancellationToken& token = CancellationToken::current();
+    token.reset(); // a Ctrl-C at the prompt does not cancel the next statement
+
+    std::packaged_task<void()> task(std::move(statement));
+    std::future<void> done = task.get_future();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        queue_.push_back(std::move(task));
+    }
+    wake_.notify_one();
+
+    if (timeout.count() > 0 && done.wait_for(timeout) == std::future_status::timeout) {
+        token.cancel(CancellationToken::Reason::TIMEOUT);
+    }
+    done.get(); // waits for the statement to unwind, rethrows what it threw
+}
+
+static void onInterrupt(int) {
+    CancellationToken::current().cancel(CancellationToken::Reason::USER);
+#ifdef _WIN32
+    std::signal(SIGINT, onInterrupt); // the handler is reset to the default after each signal
+#endif
+}
+
+void StatementExecutor::installInterruptHandler() {
+    CancellationToken::current(); // construct the token before a signal can reach it
+#ifdef _WIN32
+    std::signal(SIGINT, onInterrupt);
+#else
+    // SA_RESTART: a Ctrl-C at the prompt must not make the pending read fail.
+    struct sigaction action{};
+    action.sa_handler = onInterrupt;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+    sigaction(SIGINT, &action, nullptr);
+#endif
+}
@@ -0,0 +1,68 @@
+//
+// Statement execution: a worker thread runs one statement at a time under a cancellation token.
+//
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+// Thrown at a morsel boundary once the running statement was cancelled or timed out.
+class StatementCancelled : public std::runtime_error{
+public:
+  using std::runtime_error::runtime_error;
+  };
+
+constexpr size_t morselRows = 4096; // rows processed between two cancellation checks
+
+// Cooperative cancellation of the running statement.
+// Scans and row-by-row loops call check() once per morsel, so a cancel takes effect
+// within a few thousand rows while the per-row work pays nothing for it.
+class CancellationToken{
+public:
+  enum class Reason { NONE, USER, TIMEOUT };
+
+  static CancellationToken& current(); // token of the statement being executed
+
+  void reset() { reason_.store(Reason::NONE, std::memory_order_relaxed); }
+  void cancel(Reason reason) { reason_.store(reason, std::memory_order_relaxed); } // async-signal-safe
+  bool cancelled() const { return reason_.load(std::memory_order_relaxed) != Reason::NONE; }
+  void check() const;                  // throws StatementCancelled if cancelled()
+
+private:
+  std::atomic<Reason> reason_{Reason::NONE};
+  };
+
+// Runs statements on a dedicated worker thread, one at a time. The calling (REPL) thread
+// only waits: it enforces the timeout by cancelling the token when the deadline passes,
+// and a SIGINT handler cancels it on Ctrl-C. The statement stops at its next morsel
+// boundary and unwinds normally, so partial UPDATEs and DELETEs are rolled back.
+class StatementExecutor{
+public:
+  StatementExecutor();
+  StatementExecutor(const StatementExecutor&) = delete;
+  StatementExecutor& operator=(const StatementExecutor&) = delete;
+  ~StatementExecutor();
+
+  // Run 'statement' on the worker and wait for it; its exceptions are rethrown here.
+  // A zero timeout means no limit.
+  void run(std::function<void()> statement, std::chrono::milliseconds timeout);
+
+  static void installInterruptHandler(); // Ctrl-C cancels the running statement instead of ending the process
+
+private:
+  void workerLoop();
+
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::deque<std::packaged_task<void()>> queue_;
+  bool stopping_ = false;
+  std::thread worker_;
+  };
@@ -0,0 +1,331 @@
+//
+// Streaming export of query results (CSV, columnar binary) and reading columnar files back.
+//
+
+#include "Export.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+// Columnar file layout (native byte order):
+//   "CQLCOL1\n"                                    8-byte magic
+//   u32 length + table name
+//   u32 column count, then per column: u32 length + name, u8 DataType
+//   row groups, each:
+//     u32 row count (a row count of 0 ends the file)
+//     one block per column:
+//       INT, FLOAT: 4 bytes per row; BIGINT, DOUBLE: 8 bytes; BOOL: 1 byte
+//       STRING: (row count + 1) u64 offsets followed by the concatenated bytes
+// Row groups hold at most 64K rows, which bounds the writer's memory use.
+static constexpr char columnarMagic[8] = {'C', 'Q', 'L', 'C', 'O', 'L', '1', '\n'};
+static constexpr size_t rowGroupRows = 65536;
+static constexpr size_t writeBufferBytes = 1 << 20;
+
+ExportFormat parseExportFormat(std::string_view name) {
+    std::string upper(name);
+    std::transform(upper.begin(), upper.end(), upper.begin(), ::toupper);
+    if (upper == "CSV") return ExportFormat::CSV;
+    if (upper == "COLUMNAR") return ExportFormat::COLUMNAR;
+    throw std::runtime_error("Unknown export format: " + std::string(name) + " (use CSV or COLUMNAR)");
+}
+
+// Output file with one large buffer, so the OS sees a few big writes instead of one per value.
+// A file that is not finish()ed (because an exception left the export early) is removed again.
+class BufferedFile{
+public:
+  explicit BufferedFile(const std::string& path) : path_(path), file_(std::fopen(path.c_str(), "wb")) {
+      if (!file_) throw std::runtime_error("Could not open file for writing: " + path);
+      buffer_.reserve(writeBufferBytes);
+  }
+  BufferedFile(const BufferedFile&) = delete;
+  BufferedFile& operator=(const BufferedFile&) = delete;
+  ~BufferedFile() {
+      if (file_) {
+          std::fclose(file_);
+          std::remove(path_.c_str());
+      }
+  }
+
+  void append(const void* data, size_t size) {
+      if (buffer_.size() + size > writeBufferBytes) flush();
+      if (size >= writeBufferBytes) {
+          write(data, size); // large blocks skip the buffer
+          return;
+      }
+      buffer_.append(static_cast<const char*>(data), size);
+  }
+  void append(std::string_view text) { append(text.data(), text.size()); }
+  void append(char c) { append(&c, 1); }
+
+  template <typename T>
+  void appendRaw(T value) { append(&value, sizeof(T)); }
+
+  void finish() {
+      flush();
+      std::FILE* file = file_;
+      file_ = nullptr;
+      if (std::fclose(file) != 0) {
+          std::remove(path_.c_str());
+          throw std::runtime_error("Write failed for: " + path_);
+      }
+  }
+
+private:
+  void flush() {
+      write(buffer_.data(), buffer_.size());
+      buffer_.clear();
+  }
+  void write(const void* data, size_t size) {
+      if (size > 0 && std::fwrite(data, 1, size, file_) != size) {
+          throw std::runtime_error("Write failed for: " + path_);
+      }
+  }
+
+  std::string path_;
+  std::FILE* file_;
+  std::string buffer_;
+  };
+
+// ---------- CSV ----------
+
+// Quote a field only when it needs it (RFC 4180): commas, quotes, line breaks or edge spaces.
+static void appendCsvField(BufferedFile& out, std::string_view text) {
+    bool needsQuotes = text.find_first_of(",\"\r\n") != std::string_view::npos ||
+                       (!text.empty() && (text.front() == ' ' || text.back() == ' '));
+    if (!needsQuotes) {
+        out.append(text);
+        return;
+    }
+    out.append('"');
+    for (char c : text) {
+        if (c == '"') out.append('"');
+        out.append(c);
+    }
+    out.append('"');
+}
+
+static size_t exportCsv(const Table& table, const Predicate* predicate, const std::vector<int>& columns, BufferedFile& out) {
+    for (size_t i = 0; i < columns.size(); ++i) {
+        if (i > 0) out.append(',');
+        appendCsvField(out, table.columns[columns[i]].name);
+    }
+    out.append('\n');
+
+    size_t count = 0;
+    forEachMatchingRow(predicate, table, [&](RowRef, const Row& row) {
+        for (size_t i = 0; i < columns.size(); ++i) {
+            if (i > 0) out.append(',');
+            const Value& value = table.valueAt(row, columns[i]);
+            if (value.isString()) {
+                appendCsvField(out, value.asString());
+            } else {
+                out.append(value.toString());
+            }
+        }
+        out.append('\n');
+        count++;
+    });
+    return count;
+}
+
+// ---------- Columnar ----------
+
+// One column of the row group being built.
+struct ColumnBlock{
+  DataType type;
+  std::string data;              // fixed-width values, or the string bytes
+  std::vector<uint64_t> offsets; // STRING only: start of each value in 'data', plus the end
+  };
+
+static void appendString(BufferedFile& out, std::string_view text) {
+    out.appendRaw(static_cast<uint32_t>(text.size()));
+    out.append(text);
+}
+
+static void appendToBlock(ColumnBlock& block, const Value& value) {
+    switch (block.type) {
+        case DataType::INT: { int32_t v = value.asInt(); block.data.append(reinterpret_cast<const char*>(&v), sizeof(v)); break; }
+        case DataType::FLOAT: { float v = value.asFloat(); block.data.append(reinterpret_cast<const char*>(&v), sizeof(v)); break; }
+        case DataType::BIGINT: { int64_t v = value.asBigInt(); block.data.append(reinterpret_cast<const char*>(&v), sizeof(v)); break; }
+        case DataType::DOUBLE: { double v = value.asDouble(); block.data.append(reinterpret_cast<const char*>(&v), sizeof(v)); break; }
+        case DataType::BOOL: block.data.push_back(value.asBool() ? 1 : 0); break;
+        case DataType::STRING:
+            if (block.offsets.empty()) block.offsets.push_back(0);
+            block.data.append(value.asString());
+            block.offsets.push_back(block.data.size());
+            break;
+    }
+}
+
+static void flushRowGroup(BufferedFile& out, std::vector<ColumnBlock>& blocks, uint32_t rows) {
+    if (rows == 0) return;
+    out.appendRaw(rows);
+    for (auto& block : blocks) {
+        if (block.type == DataType::STRING) {
+            out.append(block.offsets.data(), block.offsets.size() * sizeof(uint64_t));
+            block.offsets.clear();
+        }
+        out.append(block.data);
+        block.data.clear();
+    }
+}
+
+static size_t exportColumnar(const Table& table, const Predicate* predicate, const std::vector<int>& columns, BufferedFile& out) {
+    out.append(columnarMagic, sizeof(columnarMagic));
+    appendString(out, table.name);
+    out.appendRaw(static_cast<uint32_t>(columns.size()));
+    std::vector<ColumnBlock> blocks;
+    for (int index : columns) {
+        appendString(out, table.columns[index].name);
+        out.appendRaw(static_cast<uint8_t>(table.columns[index].type));
+        blocks.push_back({table.columns[index].type, {}, {}});
+    }
+
+    size_t count = 0;
+    uint32_t groupRows = 0;
+    forEachMatchingRow(predicate, table, [&](RowRef, const Row& row) {
+        for (size_t i = 0; i < columns.size(); ++i) {
+            appendToBlock(blocks[i], table.valueAt(row, columns[i]));
+        }
+        count++;
+        if (++groupRows == rowGroupRows) {
+            flushRowGroup(out, blocks, groupRows);
+            groupRows = 0;
+        }
+    });
+    flushRowGroup(out, blocks, groupRows);
+    out.appendRaw(static_cast<uint32_t>(0));
+    return count;
+}
+
+size_t exportRows(const Table& table, const Predicate* predicate, const std::vector<int>& columns,
+                  const std::string& path, ExportFormat format) {
+    // A columnar file is read back as a table, and every table needs its primary key.
+    // Checked before the file is created, so a rejected export leaves nothing behind.
+    int pkIndex = table.primaryKeyIndex();
+    if (format == ExportFormat::COLUMNAR && std::find(columns.begin(), columns.end(), pkIndex) == columns.end()) {
+        throw std::runtime_error("COLUMNAR exports must include the primary key column '" + table.primaryKeyColumn +
+                                 "' so they can be loaded back (use FORMAT CSV for other column subsets)");
+    }
+    BufferedFile out(path);
+    size_t count = format == ExportFormat::CSV ? exportCsv(table, predicate, columns, out)
+                                               : exportColumnar(table, predicate, columns, out);
+    out.finish();
+    return count;
+}
+
+// ---------- Reading ----------
+
+bool isColumnarFile(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    char magic[sizeof(columnarMagic)] = {};
+    file.read(magic, sizeof(magic));
+    return file.gcount() == sizeof(magic) && std::memcmp(magic, columnarMagic, sizeof(magic)) == 0;
+}
+
+// Bounds-checked reads from the file image.
+struct ColumnarReader{
+  std::string_view data;
+  size_t pos = 0;
+
+  const char* take(size_t size) {
+      if (size > data.size() - pos) throw std::runtime_error("Columnar file is truncated");
+      const char* p = data.data() + pos;
+      pos += size;
+      return p;
+  }
+  template <typename T>
+  T read() {
+      T value;
+      std::memcpy(&value, take(sizeof(T)), sizeof(T));
+      return value;
+  }
+  std::string_view readString() {
+      uint32_t size = read<uint32_t>();
+      return {take(size), size};
+  }
+  };
+
+static size_t fixedWidth(DataType type) {
+    switch (type) {
+        case DataType::BOOL: return 1;
+        case DataType::INT:
+        case DataType::FLOAT: return 4;
+        case DataType::BIGINT:
+        case DataType::DOUBLE: return 8;
+        case DataType::STRING: return 0;
+    }
+    return 0;
+}
+
+Table readColumnarFile(const std::string& path) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+        throw std::runtime_error("Could not open file for reading: " + path);
+    }
+    std::string image(static_cast<size_t>(file.tellg()), '\0');
+    file.seekg(0);
+    file.read(image.data(), static_cast<std::streamsize>(image.size()));
+
+    ColumnarReader in{image};
+    if (std::memcmp(in.take(sizeof(columnarMagic)), columnarMagic, sizeof(columnarMagic)) != 0) {
+        throw std::runtime_error("Not a columnar file: " + path);
+    }
+
+    Table table;
+    table.name = std::string(in.readString());
+    uint32_t columnCount = in.read<uint32_t>();
+    for (uint32_t c = 0; c < columnCount; ++c) {
+        std::string name(in.readString());
+        uint8_t tag = in.read<uint8_t>();
+        if (tag > static_cast<uint8_t>(DataType::DOUBLE)) throw std::runtime_error("Unknown column type in columnar file");
+        DataType type = static_cast<DataType>(tag);
+        table.columns.push_back({name, type, defaultValueFor(type), 0});
+    }
+    if (table.primaryKeyIndex() == -1) {
+        throw std::runtime_error("Columnar file has no primary key column '" + table.primaryKeyColumn + "' and cannot be loaded as a table");
+    }
+
+    while (uint32_t rows = in.read<uint32_t>()) {
+        std::vector<Row> group(rows);
+        for (auto& row : group) row.values.reserve(columnCount);
+
+        for (const auto& column : table.columns) {
+            if (column.type == DataType::STRING) {
+                const char* offsetBytes = in.take((static_cast<size_t>(rows) + 1) * sizeof(uint64_t));
+                std::vector<uint64_t> offsets(rows + 1);
+                std::memcpy(offsets.data(), offsetBytes, offsets.size() * sizeof(uint64_t));
+                if (offsets.front() != 0 || !std::is_sorted(offsets.begin(), offsets.end())) {
+                    throw std::runtime_error("Columnar file has corrupt string offsets");
+                }
+                const char* bytes = in.take(offsets.back());
+                for (uint32_t r = 0; r < rows; ++r) {
+                    group[r].values.emplace_back(std::string_view(bytes + offsets[r], offsets[r + 1] - offsets[r]));
+                }
+                continue;
+            }
+
+            const char* block = in.take(fixedWidth(column.type) * rows);
+            for (uint32_t r = 0; r < rows; ++r) {
+                const char* cell = block + r * fixedWidth(column.type);
+                Value value;
+                switch (column.type) {
+                    case DataType::INT: { int32_t v; std::memcpy(&v, cell, sizeof(v)); value = Value(v); break; }
+                    case DataType::FLOAT: { float v; std::memcpy(&v, cell, sizeof(v)); value = Value(v); break; }
+                    case DataType::BIGINT: { int64_t v; std::memcpy(&v, cell, sizeof(v)); value = Value::bigInt(v); break; }
+                    case DataType::DOUBLE: { double v; std::memcpy(&v, cell, sizeof(v)); value = Value::fromDouble(v); break; }
+                    case DataType::BOOL: value = Value(*cell != 0); break;
+                    case DataType::STRING: break;
+                }
+                group[r].values.push_back(std::move(value));
+            }
+        }
+
+        table.appendRows(group);
+    }
+
+    table.resyncTrackedBytes();
+    return table;
+}
@@ -0,0 +1,32 @@
+//
+// Streaming export of query results (CSV, columnar binary) and reading columnar files back.
+//
+
+#pragma once
+
+#include "database.hpp"
+#include "Predicate.hpp"
+#include <string>
+#include <vector>
+
+// File formats for SELECT ... INTO "file" FORMAT ...
+enum class ExportFormat{
+  CSV,      // RFC 4180 text with a header line
+  COLUMNAR  // binary row groups, one block per column; see Export.cpp for the layout
+};
+
+ExportFormat parseExportFormat(std::string_view name); // throws std::runtime_error for unknown formats
+
+// Stream the rows matching 'predicate' to 'path', writing only the given columns.
+// Rows go straight from the table into a fixed-size write buffer; the result is never
+// collected in memory. Returns the number of rows written.
+// COLUMNAR exports must include the primary key column, since they are read back as tables.
+size_t exportRows(const Table& table, const Predicate* predicate, const std::vector<int>& columns,
+                  const std::string& path, ExportFormat format);
+
+// True if the file starts with the columnar format's magic bytes.
+bool isColumnarFile(const std::string& path);
+
+// Read a columnar file into a new table named after the exported one.
+// Values are copied out of the binary blocks directly, without any text parsing.
+Table readColumnarFile(const std::string& path);
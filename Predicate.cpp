@@ -0,0 +1,492 @@
+//
+// Compound WHERE clauses: parsing, selectivity-based ordering and evaluation.
+//
+
+#include "Predicate.hpp"
+#include "Executor.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <exception>
+#include <functional>
+#include <stdexcept>
+#include <thread>
+
+// ---------- Tokenizer ----------
+
+struct PredicateToken{
+  enum class Type { IDENT, LITERAL, OP, AND, OR, NOT, LPAREN, RPAREN, END };
+  Type type;
+  std::string text;
+  };
+
+static std::vector<PredicateToken> tokenizePredicate(std::string_view text) {
+    std::vector<PredicateToken> tokens;
+    size_t i = 0;
+    while (i < text.size()) {
+        char c = text[i];
+        if (std::isspace(static_cast<unsigned char>(c))) { i++; continue; }
+
+        if (c == '(') { tokens.push_back({PredicateToken::Type::LPAREN, "("}); i++; continue; }
+        if (c == ')') { tokens.push_back({PredicateToken::Type::RPAREN, ")"}); i++; continue; }
+
+        // Quoted string literal, kept with its quotes so parseValue can strip them.
+        if (c == '"') {
+            size_t end = text.find('"', i + 1);
+            if (end == std::string_view::npos) throw std::runtime_error("Unterminated string in WHERE clause");
+            tokens.push_back({PredicateToken::Type::LITERAL, std::string(text.substr(i, end - i + 1))});
+            i = end + 1;
+            continue;
+        }
+
+        // Operators; && || and a lone ! are accepted as AND, OR and NOT.
+        if (text.substr(i).starts_with("&&")) { tokens.push_back({PredicateToken::Type::AND, "AND"}); i += 2; continue; }
+        if (text.substr(i).starts_with("||")) { tokens.push_back({PredicateToken::Type::OR, "OR"}); i += 2; continue; }
+        if (c == '=' || c == '!' || c == '<' || c == '>') {
+            if (i + 1 < text.size() && text[i + 1] == '=') {
+                tokens.push_back({PredicateToken::Type::OP, std::string(text.substr(i, 2))});
+                i += 2;
+            } else if (c == '!') {
+                tokens.push_back({PredicateToken::Type::NOT, "NOT"});
+                i++;
+            } else {
+                tokens.push_back({PredicateToken::Type::OP, std::string(1, c)});
+                i++;
+            }
+            continue;
+        }
+
+        // Word: column name, keyword, number or bool literal.
+        size_t start = i;
+        while (i < text.size() && !std::isspace(static_cast<unsigned char>(text[i])) &&
+               std::string_view("()=!<>\"&|").find(text[i]) == std::string_view::npos) {
+            i++;
+        }
+        std::string word(text.substr(start, i - start));
+        std::string upper = word;
+        std::transform(upper.begin(), upper.end(), upper.begin(), ::toupper);
+
+        if (upper == "AND") tokens.push_back({PredicateToken::Type::AND, upper});
+        else if (upper == "OR") tokens.push_back({PredicateToken::Type::OR, upper});
+        else if (upper == "NOT") tokens.push_back({PredicateToken::Type::NOT, upper});
+        else if (word == "true" || word == "false" || std::isdigit(static_cast<unsigned char>(word[0])) ||
+                 word[0] == '-' || word[0] == '+' || word[0] == '.')
+            tokens.push_back({PredicateToken::Type::LITERAL, word});
+        else tokens.push_back({PredicateToken::Type::IDENT, word});
+    }
+    tokens.push_back({PredicateToken::Type::END, ""});
+    return tokens;
+}
+
+// ---------- Recursive descent parser ----------
+//   or      := and (OR and)*
+//   and     := unary (AND unary)*
+//   unary   := NOT unary | primary
+//   primary := '(' or ')' | column op literal
+
+struct PredicateParser{
+  const std::vector<PredicateToken>& tokens;
+  const Table& table;
+  size_t pos = 0;
+
+  const PredicateToken& peek() const { return tokens[pos]; }
+  const PredicateToken& next() { return tokens[pos++]; }
+
+  std::unique_ptr<Predicate> parseOr() {
+      auto left = parseAnd();
+      while (peek().type == PredicateToken::Type::OR) {
+          next();
+          left = combine(Predicate::Kind::OR, std::move(left), parseAnd());
+      }
+      return left;
+  }
+
+  std::unique_ptr<Predicate> parseAnd() {
+      auto left = parseUnary();
+      while (peek().type == PredicateToken::Type::AND) {
+          next();
+          left = combine(Predicate::Kind::AND, std::move(left), parseUnary());
+      }
+      return left;
+  }
+
+  std::unique_ptr<Predicate> parseUnary() {
+      if (peek().type == PredicateToken::Type::NOT) {
+          next();
+          auto node = std::make_unique<Predicate>();
+          node->kind = Predicate::Kind::NOT;
+          node->children.push_back(parseUnary());
+          return node;
+      }
+      return parsePrimary();
+  }
+
+  std::unique_ptr<Predicate> parsePrimary() {
+      if (peek().type == PredicateToken::Type::LPAREN) {
+          next();
+          auto inner = parseOr();
+          if (next().type != PredicateToken::Type::RPAREN) throw std::runtime_error("Missing ')' in WHERE clause");
+          return inner;
+      }
+
+      const PredicateToken& column = next();
+      if (column.type != PredicateToken::Type::IDENT) {
+          throw std::runtime_error("Expected column name in WHERE clause, got '" + column.text + "'");
+      }
+      const PredicateToken& op = next();
+      if (op.type != PredicateToken::Type::OP) {
+          throw std::runtime_error("Expected comparison operator after '" + column.text + "'");
+      }
+      const PredicateToken& literal = next();
+      if (literal.type != PredicateToken::Type::LITERAL) {
+          throw std::runtime_error("Expected value after '" + column.text + " " + op.text + "'");
+      }
+
+      auto node = std::make_unique<Predicate>();
+      node->kind = Predicate::Kind::COMPARE;
+
+      bool found = false;
+      for (size_t i = 0; i < table.columns.size(); ++i) {
+          if (table.columns[i].name == column.text) {
+              node->columnIndex = i;
+              found = true;
+              break;
+          }
+      }
+      if (!found) throw std::runtime_error("WHERE column not found: " + column.text);
+
+      if (op.text == "==" || op.text == "=") node->op = CompareOp::EQ;
+      else if (op.text == "!=") node->op = CompareOp::NE;
+      else if (op.text == ">") node->op = CompareOp::GT;
+      else if (op.text == "<") node->op = CompareOp::LT;
+      else if (op.text == ">=") node->op = CompareOp::GE;
+      else if (op.text == "<=") node->op = CompareOp::LE;
+      else throw std::runtime_error("Unsupported operator: " + op.text);
+
+      node->literal = parseValue(literal.text, table.columns[node->columnIndex].type);
+      return node;
+  }
+
+  static std::unique_ptr<Predicate> combine(Predicate::Kind kind, std::unique_ptr<Predicate> left, std::unique_ptr<Predicate> right) {
+      auto node = std::make_unique<Predicate>();
+      node->kind = kind;
+      node->children.push_back(std::move(left));
+      node->children.push_back(std::move(right));
+      return node;
+  }
+  };
+
+std::unique_ptr<Predicate> parsePredicate(std::string_view text, const Table& table) {
+    std::vector<PredicateToken> tokens = tokenizePredicate(text);
+    PredicateParser parser{tokens, table};
+    auto predicate = parser.parseOr();
+    if (parser.peek().type != PredicateToken::Type::END) {
+        throw std::runtime_error("Unexpected '" + parser.peek().text + "' in WHERE clause");
+    }
+    return predicate;
+}
+
+// ---------- Optimizer ----------
+
+// Pull children of the same kind up: (a AND (b AND c)) -> AND(a, b, c),
+// so that all conjuncts of a chain can be ordered together.
+static void flattenPredicate(Predicate& node) {
+    for (auto& child : node.children) flattenPredicate(*child);
+    if (node.kind != Predicate::Kind::AND && node.kind != Predicate::Kind::OR) return;
+
+    std::vector<std::unique_ptr<Predicate>> flat;
+    for (auto& child : node.children) {
+        if (child->kind == node.kind) {
+            for (auto& grandChild : child->children) flat.push_back(std::move(grandChild));
+        } else {
+            flat.push_back(std::move(child));
+        }
+    }
+    node.children = std::move(flat);
+}
+
+// Selectivity of a leaf comparison, assuming uniform values between min and max.
+static double estimateCompare(const Predicate& node, const Table& table, const std::vector<ColumnStats>& stats) {
+    const ColumnStats& column = stats[node.columnIndex];
+    DataType type = table.columns[node.columnIndex].type;
+    double equal = 1.0 / std::max(1.0, column.distinctCount);
+
+    if (type == DataType::BOOL) {
+        bool wanted = node.literal.asBool();
+        double match = wanted ? column.trueFraction : 1.0 - column.trueFraction;
+        return node.op == CompareOp::NE ? 1.0 - match : node.op == CompareOp::EQ ? match : 0.5;
+    }
+
+    switch (node.op) {
+        case CompareOp::EQ: return equal;
+        case CompareOp::NE: return 1.0 - equal;
+        default: break;
+    }
+    if (type == DataType::STRING) return 1.0 / 3.0; // no histogram for strings
+
+    double range = column.maxValue - column.minValue;
+    double below = range > 0.0 ? (node.literal.toNumber() - column.minValue) / range : 0.5;
+    below = std::clamp(below, 0.0, 1.0);
+    return (node.op == CompareOp::LT || node.op == CompareOp::LE) ? below : 1.0 - below;
+}
+
+static void estimatePredicate(Predicate& node, const Table& table, const std::vector<ColumnStats>& stats) {
+    switch (node.kind) {
+        case Predicate::Kind::COMPARE: {
+            node.selectivity = estimateCompare(node, table, stats);
+            // Numbers and bools compare in a couple of instructions; strings need a memcmp.
+            node.cost = table.columns[node.columnIndex].type == DataType::STRING ? 4.0 : 1.0;
+            break;
+        }
+        case Predicate::Kind::NOT: {
+            estimatePredicate(*node.children[0], table, stats);
+            node.selectivity = 1.0 - node.children[0]->selectivity;
+            node.cost = node.children[0]->cost;
+            break;
+        }
+        case Predicate::Kind::AND:
+        case Predicate::Kind::OR: {
+            bool isAnd = node.kind == Predicate::Kind::AND;
+            for (auto& child : node.children) estimatePredicate(*child, table, stats);
+
+            // Classic ordering for short-circuit chains: the cheapest test that
+            // most often decides the result goes first.
+            auto rank = [isAnd](const std::unique_ptr<Predicate>& p) {
+                double decides = isAnd ? 1.0 - p->selectivity : p->selectivity;
+                return p->cost / std::max(decides, 1e-9);
+            };
+            std::stable_sort(node.children.begin(), node.children.end(),
+                [&rank](const auto& a, const auto& b) { return rank(a) < rank(b); });
+
+            // Expected cost: each child only runs if the previous ones did not decide.
+            double reach = 1.0, cost = 0.0, pass = 1.0, fail = 1.0;
+            for (const auto& child : node.children) {
+                cost += reach * child->cost;
+                reach *= isAnd ? child->selectivity : 1.0 - child->selectivity;
+                pass *= child->selectivity;
+                fail *= 1.0 - child->selectivity;
+            }
+            node.cost = cost;
+            node.selectivity = isAnd ? pass : 1.0 - fail;
+            break;
+        }
+    }
+}
+
+void optimizePredicate(Predicate& predicate, const Table& table) {
+    flattenPredicate(predicate);
+    estimatePredicate(predicate, table, table.statistics());
+}
+
+// ---------- Evaluation ----------
+
+// Compare two cells; numeric types mix as doubles, any other type mismatch never matches.
+static bool compareValues(const Value& actual, CompareOp op, const Value& literal) {
+    if (actual.type() != literal.type()) {
+        if (!actual.isNumeric() || !literal.isNumeric()) return op == CompareOp::NE;
+        return compareValues(Value::fromDouble(actual.toNumber()), op, Value::fromDouble(literal.toNumber()));
+    }
+    switch (op) {
+        case CompareOp::EQ: return actual == literal;
+        case CompareOp::NE: return actual != literal;
+        case CompareOp::GT: return actual > literal;
+        case CompareOp::LT: return actual < literal;
+        case CompareOp::GE: return actual >= literal;
+        case CompareOp::LE: return actual <= literal;
+    }
+    return false;
+}
+
+bool evaluatePredicate(const Predicate& predicate, const Table& table, const Row& row) {
+    switch (predicate.kind) {
+        case Predicate::Kind::COMPARE:
+            return compareValues(table.valueAt(row, predicate.columnIndex), predicate.op, predicate.literal);
+        case Predicate::Kind::NOT:
+            return !evaluatePredicate(*predicate.children[0], table, row);
+        case Predicate::Kind::AND:
+            for (const auto& child : predicate.children) {
+                if (!evaluatePredicate(*child, table, row)) return false;
+            }
+            return true;
+        case Predicate::Kind::OR:
+            for (const auto& child : predicate.children) {
+                if (evaluatePredicate(*child, table, row)) return true;
+            }
+            return false;
+    }
+    return false;
+}
+
+// ---------- Row selection ----------
+
+// Find an equality test on 'columnIndex' that every matching row must satisfy:
+// the predicate itself or one conjunct of a top-level AND.
+static const Predicate* findEqualityOn(const Predicate& predicate, int columnIndex) {
+    if (columnIndex < 0) return nullptr;
+    if (predicate.kind == Predicate::Kind::COMPARE) {
+        bool usable = predicate.op == CompareOp::EQ && predicate.columnIndex == static_cast<size_t>(columnIndex);
+        return usable ? &predicate : nullptr;
+    }
+    if (predicate.kind == Predicate::Kind::AND) {
+        for (const auto& child : predicate.children) {
+            if (const Predicate* found = findEqualityOn(*child, columnIndex)) return found;
+        }
+    }
+    return nullptr;
+}
+
+// Visit the live rows of one partition that match, holding its lock.
+// Every morsel of rows the statement's cancellation token is checked.
+static void scanPartition(const Table& table, size_t p, const Predicate* predicate, const RowVisitor& visit) {
+    const CancellationToken& token = CancellationToken::current();
+    size_t visited = 0;
+    table.forEachRow(p, [&](size_t slot, const Row& row) {
+        if (++visited % morselRows == 0) token.check();
+        if (predicate && !evaluatePredicate(*predicate, table, row)) return;
+        visit({p, slot}, row);
+    });
+}
+
+void forEachMatchingRow(const Predicate* predicate, const Table& table, const RowVisitor& visit) {
+    if (predicate) {
+        // Primary-key equality: one index probe instead of a scan.
+        if (const Predicate* key = findEqualityOn(*predicate, table.primaryKeyIndex())) {
+            RowRef ref;
+            if (!table.findByPrimaryKey(key->literal, ref)) return;
+            std::lock_guard<std::mutex> lock(table.partitions[ref.partition]->mutex);
+            PinnedRow row = table.rowAt(ref);
+            if (evaluatePredicate(*predicate, table, *row)) {
+                visit(ref, *row);
+            }
+            return;
+        }
+        // Partition-key equality: only the partition that can hold the key is scanned.
+        if (const Predicate* key = findEqualityOn(*predicate, table.partitionColumn)) {
+            scanPartition(table, table.partitionFor(key->literal), predicate, visit);
+            return;
+        }
+    }
+    for (size_t p = 0; p < table.partitions.size(); ++p) {
+        scanPartition(table, p, predicate, visit);
+    }
+}
+
+// Tables with fewer rows are scanned on the calling thread, even when partitioned.
+static constexpr size_t parallelScanRows = 16384;
+
+// Run scanOne(p) for every partition on at most hardware_concurrency() threads, the
+// calling thread included. Workers take the next partition from a shared cursor, so
+// tables with many partitions do not start a thread per partition.
+// The first exception in partition order is rethrown once all workers are done.
+static void scanPartitionsInParallel(size_t partitionCount, const std::function<void(size_t)>& scanOne) {
+    std::vector<std::exception_ptr> errors(partitionCount);
+    std::atomic<size_t> next{0};
+    auto worker = [&]() {
+        for (size_t p = next++; p < partitionCount; p = next++) {
+            try {
+                scanOne(p);
+            } catch (...) {
+                errors[p] = std::current_exception(); // e.g. StatementCancelled
+            }
+        }
+    };
+
+    size_t threadCount = std::min<size_t>(partitionCount, std::max(1u, std::thread::hardware_concurrency()));
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < threadCount; ++i) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    for (const auto& error : errors) {
+        if (error) std::rethrow_exception(error);
+    }
+}
+
+std::vector<RowRef> findMatchingRows(const Predicate* predicate, const Table& table) {
+    std::vector<RowRef> result;
+    auto collect = [](std::vector<RowRef>& out) {
+        return [&out](RowRef ref, const Row&) { out.push_back(ref); };
+    };
+
+    // Point lookups, small tables and unpartitioned tables are visited on this thread.
+    size_t partitionCount = table.partitions.size();
+    bool pointLookup = predicate && (findEqualityOn(*predicate, table.primaryKeyIndex()) ||
+                                     findEqualityOn(*predicate, table.partitionColumn));
+    if (pointLookup || partitionCount == 1 || table.rowCount() < parallelScanRows) {
+        forEachMatchingRow(predicate, table, collect(result));
+        return result;
+    }
+
+    // Full scan of a large partitioned table: partitions are scanned in parallel,
+    // with the per-partition results concatenated in partition order.
+    std::vector<std::vector<RowRef>> perPartition(partitionCount);
+    scanPartitionsInParallel(partitionCount, [&](size_t p) {
+        scanPartition(table, p, predicate, collect(perPartition[p]));
+    });
+
+    for (auto& rows : perPartition) {
+        result.insert(result.end(), rows.begin(), rows.end());
+    }
+    return result;
+}
+
+std::vector<std::vector<RowRef>> findMatchingRowsShared(std::span<const Predicate* const> predicates, const Table& table) {
+    std::vector<std::vector<RowRef>> results(predicates.size());
+
+    // Primary-key lookups are answered from the index; the other queries share the scan.
+    // onlyPartition[q] is the single partition a partition-key equality restricts query q to.
+    std::vector<size_t> scanning;
+    std::vector<int> onlyPartition(predicates.size(), -1);
+    for (size_t q = 0; q < predicates.size(); ++q) {
+        const Predicate* predicate = predicates[q];
+        if (predicate && findEqualityOn(*predicate, table.primaryKeyIndex())) {
+            results[q] = findMatchingRows(predicate, table);
+            continue;
+        }
+        if (predicate) {
+            if (const Predicate* key = findEqualityOn(*predicate, table.partitionColumn)) {
+                onlyPartition[q] = static_cast<int>(table.partitionFor(key->literal));
+            }
+        }
+        scanning.push_back(q);
+    }
+    if (scanning.empty()) return results;
+
+    // One pass over a partition, routing each row to the queries it matches.
+    auto scan = [&](size_t p, std::vector<std::vector<RowRef>>& out) {
+        std::vector<size_t> active;
+        for (size_t q : scanning) {
+            if (onlyPartition[q] == -1 || onlyPartition[q] == static_cast<int>(p)) active.push_back(q);
+        }
+        if (active.empty()) return;
+
+        const CancellationToken& token = CancellationToken::current();
+        size_t visited = 0;
+        table.forEachRow(p, [&](size_t slot, const Row& row) {
+            if (++visited % morselRows == 0) token.check();
+            for (size_t q : active) {
+                if (!predicates[q] || evaluatePredicate(*predicates[q], table, row)) out[q].push_back({p, slot});
+            }
+        });
+    };
+
+    size_t partitionCount = table.partitions.size();
+    if (partitionCount == 1 || table.rowCount() < parallelScanRows) {
+        for (size_t p = 0; p < partitionCount; ++p) scan(p, results);
+        return results;
+    }
+
+    // Large partitioned table: partitions are scanned in parallel, as in findMatchingRows.
+    std::vector<std::vector<std::vector<RowRef>>> perPartition(partitionCount, std::vector<std::vector<RowRef>>(predicates.size()));
+    scanPartitionsInParallel(partitionCount, [&](size_t p) { scan(p, perPartition[p]); });
+
+    for (size_t q : scanning) {
+        for (auto& partitionRows : perPartition) {
+            results[q].insert(results[q].end(), partitionRows[q].begin(), partitionRows[q].end());
+        }
+    }
+    return results;
+}
@@ -0,0 +1,76 @@
+//
+// Compound WHERE clauses: parsing, selectivity-based ordering and evaluation.
+//
+
+#pragma once
+
+#include "database.hpp"
+#include <functional>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Comparison operators allowed in a WHERE clause.
+enum class CompareOp{
+  EQ, // ==
+  NE, // !=
+  GT, // >
+  LT, // <
+  GE, // >=
+  LE  // <=
+};
+
+// One node of a parsed WHERE expression.
+// A leaf compares one column with a literal; inner nodes combine their children.
+// Example: Price > 1000 AND (Brand == "BMW" OR NOT Electric == true)
+struct Predicate{
+  enum class Kind { COMPARE, AND, OR, NOT };
+  Kind kind = Kind::COMPARE;
+
+  // COMPARE: column op literal (the literal is already parsed as the column's type)
+  size_t columnIndex = 0;
+  CompareOp op = CompareOp::EQ;
+  Value literal;
+
+  // AND / OR / NOT
+  std::vector<std::unique_ptr<Predicate>> children;
+
+  // Filled in by optimizePredicate()
+  double selectivity = 1.0; // estimated fraction of rows that match
+  double cost = 1.0;        // estimated relative cost of evaluating this node on one row
+  };
+
+// Parse a WHERE clause against a table's schema.
+// Supports AND, OR, NOT (also &&, ||, !), parentheses and the operators ==, =, !=, >, <, >=, <=.
+// Throws std::runtime_error on syntax errors, unknown columns or badly typed literals.
+std::unique_ptr<Predicate> parsePredicate(std::string_view text, const Table& table);
+
+// Flatten nested AND/OR chains and reorder their children using the table's
+// column statistics, so that short-circuit evaluation does the least work:
+// conjuncts are sorted by cost / (1 - selectivity), disjuncts by cost / selectivity.
+void optimizePredicate(Predicate& predicate, const Table& table);
+
+// Evaluate a predicate on a row, stopping as soon as the result is known.
+bool evaluatePredicate(const Predicate& predicate, const Table& table, const Row& row);
+
+// Called once per matching row; the row's partition is locked during the call.
+using RowVisitor = std::function<void(RowRef ref, const Row& row)>;
+
+// Visit the live rows matching 'predicate' (all live rows if it is null) on the
+// calling thread, one at a time, without collecting them first.
+void forEachMatchingRow(const Predicate* predicate, const Table& table, const RowVisitor& visit);
+
+// Collect the live rows matching 'predicate' (all live rows if it is null).
+// Equality on the primary key probes the index, equality on the partition key
+// scans a single partition, and other scans fan out over the partitions.
+std::vector<RowRef> findMatchingRows(const Predicate* predicate, const Table& table);
+
+// Answer several queries on one table with a single pass over its rows.
+// Each row is read once and tested against every query's predicate (null matches
+// everything), instead of every query paying for its own scan. Primary-key lookups
+// still probe the index, and a query with partition-key equality only takes part in
+// the scan of its partition. Result i lists the matches of predicates[i], in the same
+// order findMatchingRows would return them.
+std::vector<std::vector<RowRef>> findMatchingRowsShared(std::span<const Predicate* const> predicates, const Table& table);
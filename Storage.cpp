@@ -0,0 +1,291 @@
+//
+// Paged storage: fixed-size pages on disk and a CLOCK buffer pool caching decoded pages.
+//
+
+#include "Storage.hpp"
+#include "database.hpp"
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <unordered_map>
+#include <fcntl.h>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+// ---------- PageFile ----------
+
+static std::atomic<uint64_t> nextPageFileId{1};
+
+PageFile::PageFile(std::string path) : path_(std::move(path)), id_(nextPageFileId++) {
+#ifdef _WIN32
+    fd_ = _open(path_.c_str(), _O_RDWR | _O_CREAT | _O_TRUNC | _O_BINARY, 0600);
+#else
+    fd_ = ::open(path_.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+#endif
+    if (fd_ == -1) throw std::runtime_error("Could not create page file: " + path_);
+}
+
+PageFile::~PageFile() {
+    BufferPool::instance().drop(id_);
+#ifdef _WIN32
+    _close(fd_);
+#else
+    ::close(fd_);
+#endif
+    std::remove(path_.c_str());
+}
+
+#ifdef _WIN32
+// Windows has no pread/pwrite: seek and transfer under one lock.
+static std::mutex pageFileIoMutex;
+#endif
+
+size_t PageFile::append(const std::string& data) {
+    size_t first = pageCount_;
+    size_t pages = (data.size() + pageSize - 1) / pageSize;
+    std::string padded = data;
+    padded.resize(pages * pageSize, '\0');
+
+    size_t done = 0;
+    while (done < padded.size()) {
+#ifdef _WIN32
+        std::lock_guard<std::mutex> lock(pageFileIoMutex);
+        _lseeki64(fd_, static_cast<__int64>(first * pageSize + done), SEEK_SET);
+        int written = _write(fd_, padded.data() + done, static_cast<unsigned>(padded.size() - done));
+#else
+        ssize_t written = ::pwrite(fd_, padded.data() + done, padded.size() - done, static_cast<off_t>(first * pageSize + done));
+#endif
+        if (written <= 0) throw std::runtime_error("Write failed for page file: " + path_);
+        done += static_cast<size_t>(written);
+    }
+    pageCount_ += pages;
+    return first;
+}
+
+void PageFile::read(size_t firstPage, size_t count, std::string& out) const {
+    out.resize(count * pageSize);
+    size_t done = 0;
+    while (done < out.size()) {
+#ifdef _WIN32
+        std::lock_guard<std::mutex> lock(pageFileIoMutex);
+        _lseeki64(fd_, static_cast<__int64>(firstPage * pageSize + done), SEEK_SET);
+        int got = _read(fd_, out.data() + done, static_cast<unsigned>(out.size() - done));
+#else
+        ssize_t got = ::pread(fd_, out.data() + done, out.size() - done, static_cast<off_t>(firstPage * pageSize + done));
+#endif
+        if (got <= 0) throw std::runtime_error("Read failed for page file: " + path_);
+        done += static_cast<size_t>(got);
+    }
+}
+
+void PageFile::prefetch(size_t firstPage, size_t count) const {
+#if defined(POSIX_FADV_WILLNEED) && !defined(_WIN32)
+    if (firstPage >= pageCount_) return;
+    count = std::min(count, pageCount_ - firstPage);
+    ::posix_fadvise(fd_, static_cast<off_t>(firstPage * pageSize), static_cast<off_t>(count * pageSize), POSIX_FADV_WILLNEED);
+#else
+    (void)firstPage;
+    (void)count;
+#endif
+}
+
+// ---------- Row encoding ----------
+// Run layout: u32 row count, then per row a u16 value count followed by the values,
+// each as a one-byte DataType tag and its payload (4 or 8 bytes for numbers, 1 for
+// bools, u32 length + bytes for strings).
+
+template <typename T>
+static void putRaw(std::string& out, T value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+static void encodeRow(std::string& out, const Row& row) {
+    putRaw(out, static_cast<uint16_t>(row.values.size()));
+    for (const auto& value : row.values) {
+        putRaw(out, static_cast<uint8_t>(value.type()));
+        switch (value.type()) {
+            case DataType::INT: putRaw(out, static_cast<int32_t>(value.asInt())); break;
+            case DataType::FLOAT: putRaw(out, value.asFloat()); break;
+            case DataType::BIGINT: putRaw(out, value.asBigInt()); break;
+            case DataType::DOUBLE: putRaw(out, value.asDouble()); break;
+            case DataType::BOOL: putRaw(out, static_cast<uint8_t>(value.asBool())); break;
+            case DataType::STRING: {
+                std::string_view text = value.asString();
+                putRaw(out, static_cast<uint32_t>(text.size()));
+                out.append(text);
+                break;
+            }
+        }
+    }
+}
+
+std::vector<PageInfo> writePages(PageFile& file, const std::vector<Row>& rows, const std::vector<bool>& deleted,
+                                 size_t firstSlot) {
+    std::vector<PageInfo> runs;
+    std::string run;
+    std::string encoded;
+    PageInfo info;
+    info.firstSlot = firstSlot;
+
+    auto flush = [&] {
+        if (info.rowCount == 0) return;
+        std::memcpy(run.data(), &info.rowCount, sizeof(info.rowCount));
+        info.firstPage = file.append(run);
+        info.span = static_cast<uint32_t>((run.size() + pageSize - 1) / pageSize);
+        runs.push_back(info);
+        info.firstSlot += info.rowCount;
+        info.rowCount = 0;
+        run.clear();
+    };
+
+    for (size_t r = 0; r < rows.size(); ++r) {
+        encoded.clear();
+        if (r < deleted.size() && deleted[r]) {
+            putRaw(encoded, static_cast<uint16_t>(0)); // placeholder keeps the slot numbering
+        } else {
+            encodeRow(encoded, rows[r]);
+        }
+        if (!run.empty() && run.size() + encoded.size() > pageSize) flush();
+        if (run.empty()) run.assign(sizeof(uint32_t), '\0');
+        run += encoded;
+        info.rowCount++;
+    }
+    flush();
+    return runs;
+}
+
+static std::shared_ptr<Page> decodePage(const std::string& data, const PageFile& file) {
+    auto page = std::make_shared<Page>();
+    size_t pos = 0;
+    auto take = [&](size_t size) {
+        if (size > data.size() - pos) throw std::runtime_error("Corrupt page in " + file.path());
+        const char* p = data.data() + pos;
+        pos += size;
+        return p;
+    };
+    auto get = [&]<typename T>(T) {
+        T value;
+        std::memcpy(&value, take(sizeof(T)), sizeof(T));
+        return value;
+    };
+
+    uint32_t rowCount = get(uint32_t{});
+    page->rows.resize(rowCount);
+    page->bytes = sizeof(Page) + rowCount * sizeof(Row);
+    for (auto& row : page->rows) {
+        uint16_t valueCount = get(uint16_t{});
+        row.values.reserve(valueCount);
+        for (uint16_t v = 0; v < valueCount; ++v) {
+            switch (static_cast<DataType>(get(uint8_t{}))) {
+                case DataType::INT: row.values.emplace_back(static_cast<int>(get(int32_t{}))); break;
+                case DataType::FLOAT: row.values.emplace_back(get(float{})); break;
+                case DataType::BIGINT: row.values.push_back(Value::bigInt(get(int64_t{}))); break;
+                case DataType::DOUBLE: row.values.push_back(Value::fromDouble(get(double{}))); break;
+                case DataType::BOOL: row.values.emplace_back(get(uint8_t{}) != 0); break;
+                case DataType::STRING: {
+                    uint32_t size = get(uint32_t{});
+                    row.values.emplace_back(std::string_view(take(size), size));
+                    break;
+                }
+                default: throw std::runtime_error("Corrupt page in " + file.path());
+            }
+        }
+        page->bytes += estimateRowBytes(row.values) - sizeof(Row);
+    }
+    return page;
+}
+
+// ---------- BufferPool ----------
+
+BufferPool& BufferPool::instance() {
+    static BufferPool pool;
+    return pool;
+}
+
+std::shared_ptr<const Page> BufferPool::fetch(const PageFile& file, const PageInfo& info, bool sequential) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto found = lookup_.find(frameKey(file.id(), info.firstPage));
+        if (found != lookup_.end()) {
+            Frame& frame = frames_[found->second];
+            if (!sequential) frame.referenced = true;
+            hits++;
+            return frame.page;
+        }
+    }
+
+    // Miss: read and decode without holding the pool lock, so other partitions' scans keep going.
+    misses++;
+    std::string data;
+    file.read(info.firstPage, info.span, data);
+    std::shared_ptr<const Page> page = decodePage(data, file);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint64_t key = frameKey(file.id(), info.firstPage);
+    auto found = lookup_.find(key);
+    if (found != lookup_.end()) {
+        return frames_[found->second].page; // another thread loaded it meanwhile
+    }
+    Frame fresh{file.id(), info.firstPage, page, !sequential};
+    size_t index = frames_.size();
+    if (!freeFrames_.empty()) {
+        index = freeFrames_.back();
+        freeFrames_.pop_back();
+        frames_[index] = std::move(fresh);
+    } else {
+        frames_.push_back(std::move(fresh));
+    }
+    lookup_[key] = index;
+    residentBytes_ += page->bytes;
+    evictUntilWithinBudget();
+    return page;
+}
+
+void BufferPool::evictUntilWithinBudget() {
+    // Two full sweeps clear every reference bit once; if still nothing can go,
+    // all pages are pinned and the pool runs over budget until they are released.
+    size_t steps = 0;
+    while (residentBytes_ > budget_ && !frames_.empty() && steps < 2 * frames_.size()) {
+        hand_ = (hand_ + 1) % frames_.size();
+        steps++;
+        Frame& frame = frames_[hand_];
+        if (!frame.page) continue;
+        if (frame.referenced) {
+            frame.referenced = false;
+            continue;
+        }
+        if (frame.page.use_count() > 1) continue; // pinned by a reader
+        residentBytes_ -= frame.page->bytes;
+        frame.page.reset();
+        lookup_.erase(frameKey(frame.fileId, frame.firstPage));
+        freeFrames_.push_back(hand_);
+        evictions++;
+    }
+}
+
+void BufferPool::drop(uint64_t fileId) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t i = 0; i < frames_.size(); ++i) {
+        Frame& frame = frames_[i];
+        if (frame.page && frame.fileId == fileId) {
+            residentBytes_ -= frame.page->bytes;
+            frame.page.reset();
+            lookup_.erase(frameKey(frame.fileId, frame.firstPage));
+            freeFrames_.push_back(i);
+        }
+    }
+}
+
+void BufferPool::setBudget(size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    budget_ = bytes;
+    evictUntilWithinBudget();
+}
+
+size_t BufferPool::residentBytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return residentBytes_;
+}
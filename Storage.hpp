@@ -0,0 +1,104 @@
+//
+// Paged storage: fixed-size pages on disk and a CLOCK buffer pool caching decoded pages.
+//
+
+#pragma once
+
+#include "Value.hpp"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct Row;
+
+constexpr size_t pageSize = 64 * 1024; // bytes per page on disk
+
+// Scratch file of fixed-size pages. Page n lives at byte offset n * pageSize.
+// The file is created empty and removed again when the PageFile is destroyed:
+// it only extends a table's storage for the lifetime of the process.
+class PageFile{
+public:
+  explicit PageFile(std::string path);
+  PageFile(const PageFile&) = delete;
+  PageFile& operator=(const PageFile&) = delete;
+  ~PageFile();
+
+  uint64_t id() const { return id_; }           // key of this file's pages in the buffer pool
+  const std::string& path() const { return path_; }
+  size_t pageCount() const { return pageCount_; }
+
+  size_t append(const std::string& data);        // write data as whole pages at the end, returns the first page
+  void read(size_t firstPage, size_t count, std::string& out) const;
+  void prefetch(size_t firstPage, size_t count) const; // ask the OS to start reading pages ahead (no-op if unsupported)
+
+private:
+  std::string path_;
+  uint64_t id_;
+  int fd_ = -1;
+  size_t pageCount_ = 0;
+  };
+
+// Where one run of rows is stored: 'span' consecutive pages starting at 'firstPage'.
+// A run normally fits in one page; a run holding a single oversized row spans several.
+struct PageInfo{
+  size_t firstPage = 0;
+  uint32_t span = 1;
+  uint32_t rowCount = 0;
+  size_t firstSlot = 0; // slot number of the run's first row within its partition
+  };
+
+// Rows of one run after decoding, shared between the pool and its readers.
+struct Page{
+  std::vector<Row> rows;
+  size_t bytes = 0; // memory charged against the pool budget
+  };
+
+// Pack rows into runs of at most one page each and append them to 'file'.
+// Slots of deleted rows are written as empty rows so the slot numbering is kept.
+std::vector<PageInfo> writePages(PageFile& file, const std::vector<Row>& rows, const std::vector<bool>& deleted,
+                                 size_t firstSlot);
+
+// Caches decoded pages of all page files under one memory budget.
+//
+// Eviction uses the CLOCK algorithm: a hand sweeps the frames, clearing reference
+// bits and evicting the first unreferenced page that nobody holds. A page stays pinned
+// while a reader holds its shared_ptr. Pages loaded by sequential scans start with a
+// clear reference bit, so one large scan cannot push out the pages used by point lookups.
+class BufferPool{
+public:
+  static BufferPool& instance();
+
+  std::shared_ptr<const Page> fetch(const PageFile& file, const PageInfo& info, bool sequential);
+  void drop(uint64_t fileId);                   // forget the pages of a file that is going away
+
+  void setBudget(size_t bytes);
+  size_t budget() const { return budget_; }
+  size_t residentBytes() const;
+
+  std::atomic<size_t> hits{0};
+  std::atomic<size_t> misses{0};
+  std::atomic<size_t> evictions{0};
+
+private:
+  struct Frame{
+    uint64_t fileId = 0;
+    size_t firstPage = 0;
+    std::shared_ptr<const Page> page;
+    bool referenced = false;
+    };
+
+  static uint64_t frameKey(uint64_t fileId, size_t firstPage) { return (fileId << 40) ^ firstPage; }
+  void evictUntilWithinBudget();                // caller holds mutex_
+
+  mutable std::mutex mutex_;
+  std::vector<Frame> frames_;
+  std::unordered_map<uint64_t, size_t> lookup_; // frameKey -> index in frames_
+  std::vector<size_t> freeFrames_;              // frames whose page was evicted or dropped
+  size_t hand_ = 0;
+  size_t residentBytes_ = 0;
+  size_t budget_ = 64 * 1024 * 1024;
+  };
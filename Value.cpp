@@ -0,0 +1,130 @@
+//
+// Compact tagged cell value used by every row in the database.
+//
+
+#include "Value.hpp"
+#include <stdexcept>
+
+Value::Value(std::string_view s) {
+    std::memset(data_, 0, sizeof(data_));
+    type_ = DataType::STRING;
+    if (s.size() <= maxInlineString) {
+        std::memcpy(data_, s.data(), s.size());
+        inlineLength_ = static_cast<uint8_t>(s.size());
+        return;
+    }
+    if (s.size() > UINT32_MAX) {
+        throw std::runtime_error("String value too long");
+    }
+    char* buffer = new char[s.size()];
+    std::memcpy(buffer, s.data(), s.size());
+    uint32_t length = static_cast<uint32_t>(s.size());
+    std::memcpy(data_, &buffer, sizeof(buffer));
+    std::memcpy(data_ + 8, &length, sizeof(length));
+    inlineLength_ = heapMarker;
+}
+
+Value::Value(const Value& other) {
+    copyBits(other);
+    if (other.isHeapString()) {
+        // Deep copy: every Value owns its buffer.
+        char* buffer = new char[other.heapLength()];
+        std::memcpy(buffer, other.heapPointer(), other.heapLength());
+        std::memcpy(data_, &buffer, sizeof(buffer));
+    }
+}
+
+Value::Value(Value&& other) noexcept {
+    copyBits(other);
+    other.setScalar(DataType::INT, 0); // the buffer now belongs to us
+}
+
+Value& Value::operator=(const Value& other) {
+    if (this != &other) {
+        Value copy(other);
+        *this = std::move(copy);
+    }
+    return *this;
+}
+
+Value& Value::operator=(Value&& other) noexcept {
+    if (this != &other) {
+        release();
+        copyBits(other);
+        other.setScalar(DataType::INT, 0);
+    }
+    return *this;
+}
+
+void Value::release() noexcept {
+    if (isHeapString()) {
+        delete[] heapPointer();
+        setScalar(DataType::INT, 0);
+    }
+}
+
+std::string_view Value::asString() const {
+    if (isHeapString()) return {heapPointer(), heapLength()};
+    return {reinterpret_cast<const char*>(data_), inlineLength_};
+}
+
+double Value::toNumber() const {
+    switch (type_) {
+        case DataType::INT: return asInt();
+        case DataType::FLOAT: return asFloat();
+        case DataType::BIGINT: return static_cast<double>(asBigInt());
+        case DataType::DOUBLE: return asDouble();
+        default: return 0.0;
+    }
+}
+
+std::string Value::toString() const {
+    switch (type_) {
+        case DataType::INT: return fmt::format("{}", asInt());
+        case DataType::FLOAT: return fmt::format("{}", asFloat());
+        case DataType::BIGINT: return fmt::format("{}", asBigInt());
+        case DataType::DOUBLE: return fmt::format("{}", asDouble());
+        case DataType::BOOL: return asBool() ? "true" : "false";
+        case DataType::STRING: return std::string(asString());
+    }
+    return {};
+}
+
+bool Value::operator==(const Value& other) const {
+    if (type_ != other.type_) return false;
+    switch (type_) {
+        case DataType::INT: return asInt() == other.asInt();
+        case DataType::FLOAT: return asFloat() == other.asFloat();
+        case DataType::BIGINT: return asBigInt() == other.asBigInt();
+        case DataType::DOUBLE: return asDouble() == other.asDouble();
+        case DataType::BOOL: return asBool() == other.asBool();
+        case DataType::STRING: return asString() == other.asString();
+    }
+    return false;
+}
+
+bool Value::operator<(const Value& other) const {
+    if (type_ != other.type_) return type_ < other.type_;
+    switch (type_) {
+        case DataType::INT: return asInt() < other.asInt();
+        case DataType::FLOAT: return asFloat() < other.asFloat();
+        case DataType::BIGINT: return asBigInt() < other.asBigInt();
+        case DataType::DOUBLE: return asDouble() < other.asDouble();
+        case DataType::BOOL: return asBool() < other.asBool();
+        case DataType::STRING: return asString() < other.asString();
+    }
+    return false;
+}
+
+size_t Value::hash() const {
+    size_t h = 0;
+    switch (type_) {
+        case DataType::INT: h = std::hash<int>{}(asInt()); break;
+        case DataType::FLOAT: h = std::hash<float>{}(asFloat()); break;
+        case DataType::BIGINT: h = std::hash<int64_t>{}(asBigInt()); break;
+        case DataType::DOUBLE: h = std::hash<double>{}(asDouble()); break;
+        case DataType::BOOL: h = std::hash<bool>{}(asBool()); break;
+        case DataType::STRING: h = std::hash<std::string_view>{}(asString()); break;
+    }
+    return h ^ (static_cast<size_t>(type_) * 0x9e3779b97f4a7c15ull);
+}
@@ -0,0 +1,129 @@
+//
+// Compact tagged cell value used by every row in the database.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <fmt/format.h>
+
+// representing supported datatypes in the database.
+// The enum doubles as the type tag of Value, so it is kept to one byte.
+enum class DataType : uint8_t{
+
+  INT,     // 32-bit signed integer
+  FLOAT,   // single precision
+  STRING,
+  BOOL,
+  BIGINT,  // 64-bit signed integer
+  DOUBLE   // double precision
+  };
+
+// A single cell: 16 bytes for every type.
+//
+// Layout: 14 payload bytes, one byte of inline string length and the DataType tag.
+// - numbers and bools live in the first 8 payload bytes
+// - strings of up to 14 bytes are stored inline, without any allocation
+// - longer strings keep a pointer (8 bytes) and a 32-bit length in the payload
+//   and own an exactly sized heap buffer
+//
+// Two values are equal only if they have the same type, as with the std::variant
+// this class replaces; numeric comparisons across types are done by callers.
+class Value{
+public:
+  static constexpr size_t maxInlineString = 14;
+
+  Value() noexcept : Value(0) {}
+  Value(int v) noexcept { setScalar(DataType::INT, v); }
+  Value(float v) noexcept { setScalar(DataType::FLOAT, v); }
+  Value(bool v) noexcept { setScalar(DataType::BOOL, v); }
+  Value(const char* s) : Value(std::string_view(s)) {}
+  Value(const std::string& s) : Value(std::string_view(s)) {}
+  Value(std::string_view s);
+
+  static Value bigInt(int64_t v) noexcept { Value value; value.setScalar(DataType::BIGINT, v); return value; }
+  static Value fromDouble(double v) noexcept { Value value; value.setScalar(DataType::DOUBLE, v); return value; }
+
+  Value(const Value& other);
+  Value(Value&& other) noexcept;
+  Value& operator=(const Value& other);
+  Value& operator=(Value&& other) noexcept;
+  ~Value() { release(); }
+
+  DataType type() const { return type_; }
+  bool isString() const { return type_ == DataType::STRING; }
+  bool isNumeric() const { return type_ != DataType::STRING && type_ != DataType::BOOL; }
+
+  int asInt() const { return scalar<int>(); }
+  int64_t asBigInt() const { return scalar<int64_t>(); }
+  float asFloat() const { return scalar<float>(); }
+  double asDouble() const { return scalar<double>(); }
+  bool asBool() const { return scalar<bool>(); }
+  std::string_view asString() const;
+
+  double toNumber() const;          // any numeric type as double, 0 for strings and bools
+  std::string toString() const;     // text as printed by SELECT (strings without quotes)
+  size_t heapBytes() const { return isHeapString() ? heapLength() : 0; } // bytes allocated outside the 16
+
+  bool operator==(const Value& other) const;
+  bool operator!=(const Value& other) const { return !(*this == other); }
+  bool operator<(const Value& other) const;   // orders by type tag first, then by value
+  bool operator>(const Value& other) const { return other < *this; }
+  bool operator<=(const Value& other) const { return !(other < *this); }
+  bool operator>=(const Value& other) const { return !(*this < other); }
+
+  size_t hash() const;
+
+private:
+  static constexpr uint8_t heapMarker = 0xFF;
+
+  alignas(8) unsigned char data_[14];
+  uint8_t inlineLength_ = 0; // inline string length, or heapMarker for heap strings
+  DataType type_ = DataType::INT;
+
+  template <typename T>
+  void setScalar(DataType type, T v) noexcept {
+      std::memset(data_, 0, sizeof(data_));
+      std::memcpy(data_, &v, sizeof(T));
+      inlineLength_ = 0;
+      type_ = type;
+  }
+
+  template <typename T>
+  T scalar() const {
+      T v;
+      std::memcpy(&v, data_, sizeof(T));
+      return v;
+  }
+
+  void copyBits(const Value& other) noexcept {
+      std::memcpy(data_, other.data_, sizeof(data_));
+      inlineLength_ = other.inlineLength_;
+      type_ = other.type_;
+  }
+
+  bool isHeapString() const { return type_ == DataType::STRING && inlineLength_ == heapMarker; }
+  const char* heapPointer() const { return scalar<const char*>(); }
+  uint32_t heapLength() const { uint32_t n; std::memcpy(&n, data_ + 8, sizeof(n)); return n; }
+  void release() noexcept;
+  };
+
+static_assert(sizeof(Value) == 16, "Value must stay 16 bytes");
+
+template <>
+struct std::hash<Value>{
+  size_t operator()(const Value& value) const noexcept { return value.hash(); }
+  };
+
+// Lets fmt print a Value directly, with the usual width/alignment specs: fmt::print("{:<12}", value)
+template <>
+struct fmt::formatter<Value> : fmt::formatter<std::string_view>{
+  auto format(const Value& value, fmt::format_context& ctx) const {
+      std::string text = value.toString();
+      return fmt::formatter<std::string_view>::format(std::string_view(text), ctx);
+  }
+  };
@@ -0,0 +1,321 @@
+//
+// Materialized views: a SELECT whose result is stored and kept up to date incrementally.
+//
+
+#include "View.hpp"
+#include <algorithm>
+#include <cctype>
+#include <stdexcept>
+
+static std::string trimmed(std::string_view text) {
+    size_t first = text.find_first_not_of(" \t\r\n");
+    if (first == std::string_view::npos) return {};
+    size_t last = text.find_last_not_of(" \t\r\n");
+    return std::string(text.substr(first, last - first + 1));
+}
+
+static std::vector<std::string> splitList(std::string_view text) {
+    std::vector<std::string> items;
+    size_t start = 0;
+    for (size_t i = 0; i <= text.size(); ++i) {
+        if (i < text.size() && text[i] != ',') continue;
+        std::string item = trimmed(text.substr(start, i - start));
+        if (item.empty()) throw std::runtime_error("Empty item in column list");
+        items.push_back(std::move(item));
+        start = i + 1;
+    }
+    return items;
+}
+
+// Position of a keyword in upper-cased text, as a whole word and outside string literals.
+static size_t findKeyword(std::string_view upper, std::string_view keyword, size_t from = 0) {
+    bool inQuotes = false;
+    for (size_t i = 0; i < upper.size(); ++i) {
+        if (upper[i] == '"') inQuotes = !inQuotes;
+        if (inQuotes || i < from || upper.substr(i, keyword.size()) != keyword) continue;
+        bool startsWord = i == 0 || std::isspace(static_cast<unsigned char>(upper[i - 1]));
+        size_t end = i + keyword.size();
+        bool endsWord = end == upper.size() || std::isspace(static_cast<unsigned char>(upper[end]));
+        if (startsWord && endsWord) return i;
+    }
+    return std::string_view::npos;
+}
+
+static int columnIndex(const Table& table, std::string_view name) {
+    for (size_t i = 0; i < table.columns.size(); ++i) {
+        if (table.columns[i].name == name) return static_cast<int>(i);
+    }
+    throw std::runtime_error("Column not found: " + std::string(name));
+}
+
+// ---------- Definition ----------
+
+MaterializedView::MaterializedView(std::string name, std::string select) : name_(std::move(name)), select_(std::move(select)) {
+    std::string upper = select_;
+    std::transform(upper.begin(), upper.end(), upper.begin(), ::toupper);
+
+    size_t selectPos = findKeyword(upper, "SELECT");
+    size_t fromPos = findKeyword(upper, "FROM");
+    if (selectPos != 0 || fromPos == std::string::npos) {
+        throw std::runtime_error("expected SELECT ... FROM table");
+    }
+    size_t wherePos = findKeyword(upper, "WHERE", fromPos);
+    size_t groupPos = findKeyword(upper, "GROUP", fromPos);
+    if (groupPos != std::string::npos && findKeyword(upper, "BY", groupPos) != groupPos + 6) {
+        throw std::runtime_error("expected GROUP BY");
+    }
+    if (wherePos != std::string::npos && groupPos != std::string::npos && groupPos < wherePos) {
+        throw std::runtime_error("WHERE must come before GROUP BY");
+    }
+
+    selectText_ = splitList(std::string_view(select_).substr(6, fromPos - 6));
+    size_t tableEnd = std::min(wherePos, groupPos);
+    baseTable_ = trimmed(std::string_view(select_).substr(fromPos + 4, tableEnd == std::string::npos ? std::string::npos : tableEnd - fromPos - 4));
+    if (baseTable_.empty() || baseTable_.find_first_of(" \t") != std::string::npos) {
+        throw std::runtime_error("expected one table name after FROM");
+    }
+    if (wherePos != std::string::npos) {
+        whereText_ = trimmed(std::string_view(select_).substr(wherePos + 5, groupPos == std::string::npos ? std::string::npos : groupPos - wherePos - 5));
+        if (whereText_.empty()) throw std::runtime_error("empty WHERE clause");
+    }
+    if (groupPos != std::string::npos) {
+        groupByText_ = splitList(std::string_view(select_).substr(groupPos + 8));
+    }
+}
+
+// Resolve column names and aggregates against the base table's current schema.
+void MaterializedView::compile(const Table& base) {
+    columns_.clear();
+    groupBy_.clear();
+    aggregated_ = !groupByText_.empty();
+    keyColumn_ = base.primaryKeyIndex();
+    if (keyColumn_ == -1) throw std::runtime_error("Primary key column not found.");
+
+    for (const auto& item : selectText_) {
+        size_t open = item.find('(');
+        if (item == "*") {
+            for (size_t i = 0; i < base.columns.size(); ++i) {
+                columns_.push_back({base.columns[i].name, false, AggregateKind::COUNT, static_cast<int>(i)});
+            }
+            continue;
+        }
+        if (open == std::string::npos) {
+            columns_.push_back({item, false, AggregateKind::COUNT, columnIndex(base, item)});
+            continue;
+        }
+
+        std::string function = trimmed(std::string_view(item).substr(0, open));
+        std::transform(function.begin(), function.end(), function.begin(), ::toupper);
+        size_t close = item.find(')', open);
+        if (close == std::string::npos || close != item.size() - 1) throw std::runtime_error("Malformed aggregate: " + item);
+        std::string argument = trimmed(std::string_view(item).substr(open + 1, close - open - 1));
+
+        ViewColumn column{item, true, AggregateKind::COUNT, -1};
+        if (function == "COUNT") {
+            if (argument != "*") column.column = columnIndex(base, argument);
+        } else if (function == "SUM" || function == "AVG") {
+            column.kind = function == "SUM" ? AggregateKind::SUM : AggregateKind::AVG;
+            column.column = columnIndex(base, argument);
+            DataType type = base.columns[column.column].type;
+            if (type == DataType::STRING || type == DataType::BOOL) {
+                throw std::runtime_error(function + " needs a numeric column: " + argument);
+            }
+            column.exact = type == DataType::INT || type == DataType::BIGINT;
+        } else {
+            throw std::runtime_error("Unsupported aggregate: " + function + " (use COUNT, SUM or AVG)");
+        }
+        columns_.push_back(std::move(column));
+        aggregated_ = true;
+    }
+
+    for (const auto& name : groupByText_) {
+        groupBy_.push_back(columnIndex(base, name));
+    }
+    if (aggregated_) {
+        for (const auto& column : columns_) {
+            if (!column.aggregate && std::find(groupBy_.begin(), groupBy_.end(), column.column) == groupBy_.end()) {
+                throw std::runtime_error("Column '" + column.name + "' must appear in GROUP BY");
+            }
+        }
+    }
+
+    predicate_.reset();
+    if (!whereText_.empty()) {
+        predicate_ = parsePredicate(whereText_, base);
+        optimizePredicate(*predicate_, base);
+    }
+}
+
+void MaterializedView::rebuild(const Table& base) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        compile(base);
+        rows_.clear();
+        rowKeys_.clear();
+        rowByKey_.clear();
+        groups_.clear();
+        groupByKey_.clear();
+        if (aggregated_ && groupBy_.empty()) {
+            // Without GROUP BY there is always exactly one result row, even for an empty table.
+            groups_.push_back({{}, 0, std::vector<int64_t>(columns_.size(), 0), std::vector<double>(columns_.size(), 0.0)});
+            groupByKey_.emplace(std::vector<Value>{}, 0);
+        }
+    }
+
+    // The view lock is taken per row inside the scan, after the partition lock,
+    // in the same order as the maintenance hooks take them.
+    forEachMatchingRow(predicate_.get(), base, [&](RowRef, const Row& row) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        add(base, row);
+    });
+}
+
+// ---------- Maintenance ----------
+
+size_t MaterializedView::GroupKeyHash::operator()(const std::vector<Value>& keys) const noexcept {
+    size_t seed = keys.size();
+    for (const auto& key : keys) {
+        seed ^= key.hash() + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2);
+    }
+    return seed;
+}
+
+std::vector<Value> MaterializedView::groupKeys(const Table& base, const Row& row) const {
+    std::vector<Value> keys;
+    keys.reserve(groupBy_.size());
+    for (int column : groupBy_) keys.push_back(base.valueAt(row, column));
+    return keys;
+}
+
+bool MaterializedView::matches(const Table& base, const Row& row) const {
+    return !predicate_ || evaluatePredicate(*predicate_, base, row);
+}
+
+void MaterializedView::rowInserted(const Table& base, const Row& row) {
+    if (!matches(base, row)) return;
+    std::lock_guard<std::mutex> lock(mutex_);
+    add(base, row);
+}
+
+void MaterializedView::rowDeleted(const Table& base, const Row& row) {
+    if (!matches(base, row)) return;
+    std::lock_guard<std::mutex> lock(mutex_);
+    remove(base, row);
+}
+
+void MaterializedView::add(const Table& base, const Row& row) {
+    if (!aggregated_) {
+        Value key = base.valueAt(row, keyColumn_);
+        std::vector<Value> values;
+        values.reserve(columns_.size());
+        for (const auto& column : columns_) values.push_back(base.valueAt(row, column.column));
+
+        auto [it, inserted] = rowByKey_.emplace(key, rows_.size());
+        if (!inserted) {
+            rows_[it->second] = std::move(values);
+            return;
+        }
+        rows_.push_back(std::move(values));
+        rowKeys_.push_back(std::move(key));
+        return;
+    }
+
+    std::vector<Value> keys = groupKeys(base, row);
+    auto found = groupByKey_.find(keys);
+    if (found == groupByKey_.end()) {
+        found = groupByKey_.emplace(keys, groups_.size()).first;
+        groups_.push_back({std::move(keys), 0, std::vector<int64_t>(columns_.size(), 0), std::vector<double>(columns_.size(), 0.0)});
+    }
+    Group& group = groups_[found->second];
+    group.rows++;
+    for (size_t i = 0; i < columns_.size(); ++i) {
+        const ViewColumn& column = columns_[i];
+        if (!column.aggregate || column.kind == AggregateKind::COUNT) continue;
+        const Value& value = base.valueAt(row, column.column);
+        if (value.type() == DataType::INT) group.intSums[i] += value.asInt();
+        else if (value.type() == DataType::BIGINT) group.intSums[i] += value.asBigInt();
+        else group.sums[i] += value.toNumber(); // FLOAT, DOUBLE
+    }
+}
+
+void MaterializedView::remove(const Table& base, const Row& row) {
+    if (!aggregated_) {
+        auto found = rowByKey_.find(base.valueAt(row, keyColumn_));
+        if (found == rowByKey_.end()) return;
+        size_t index = found->second;
+        size_t last = rows_.size() - 1;
+        rowByKey_.erase(found);
+        if (index != last) {
+            rows_[index] = std::move(rows_[last]);
+            rowKeys_[index] = std::move(rowKeys_[last]);
+            rowByKey_[rowKeys_[index]] = index;
+        }
+        rows_.pop_back();
+        rowKeys_.pop_back();
+        return;
+    }
+
+    auto found = groupByKey_.find(groupKeys(base, row));
+    if (found == groupByKey_.end()) return;
+    size_t index = found->second;
+    Group& group = groups_[index];
+    group.rows--;
+    for (size_t i = 0; i < columns_.size(); ++i) {
+        const ViewColumn& column = columns_[i];
+        if (!column.aggregate || column.kind == AggregateKind::COUNT) continue;
+        const Value& value = base.valueAt(row, column.column);
+        if (value.type() == DataType::INT) group.intSums[i] -= value.asInt();
+        else if (value.type() == DataType::BIGINT) group.intSums[i] -= value.asBigInt();
+        else group.sums[i] -= value.toNumber(); // FLOAT, DOUBLE
+    }
+
+    if (group.rows > 0 || groupBy_.empty()) return;
+    // An empty group disappears; the last group takes its place.
+    size_t last = groups_.size() - 1;
+    groupByKey_.erase(found);
+    if (index != last) {
+        groups_[index] = std::move(groups_[last]);
+        groupByKey_[groups_[index].keys] = index;
+    }
+    groups_.pop_back();
+}
+
+// ---------- Reading ----------
+
+void MaterializedView::forEachRow(const std::function<void(const std::vector<Value>& values)>& visit) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!aggregated_) {
+        for (const auto& values : rows_) visit(values);
+        return;
+    }
+
+    std::vector<Value> values(columns_.size());
+    for (const auto& group : groups_) {
+        for (size_t i = 0; i < columns_.size(); ++i) {
+            const ViewColumn& column = columns_[i];
+            if (!column.aggregate) {
+                values[i] = group.keys[std::find(groupBy_.begin(), groupBy_.end(), column.column) - groupBy_.begin()];
+                continue;
+            }
+            switch (column.kind) {
+                case AggregateKind::COUNT:
+                    values[i] = Value::bigInt(static_cast<int64_t>(group.rows));
+                    break;
+                case AggregateKind::SUM:
+                    values[i] = column.exact ? Value::bigInt(group.intSums[i]) : Value::fromDouble(group.sums[i]);
+                    break;
+                case AggregateKind::AVG: {
+                    double sum = column.exact ? static_cast<double>(group.intSums[i]) : group.sums[i];
+                    values[i] = Value::fromDouble(group.rows > 0 ? sum / static_cast<double>(group.rows) : 0.0);
+                    break;
+                }
+            }
+        }
+        visit(values);
+    }
+}
+
+size_t MaterializedView::rowCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return aggregated_ ? groups_.size() : rows_.size();
+}
@@ -0,0 +1,103 @@
+//
+// Materialized views: a SELECT whose result is stored and kept up to date incrementally.
+//
+
+#pragma once
+
+#include "database.hpp"
+#include "Predicate.hpp"
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Aggregates a view can maintain. Each one can be updated in O(1) when a row
+// enters or leaves the view, which is what makes incremental maintenance possible.
+enum class AggregateKind{
+  COUNT, // COUNT(*) or COUNT(column) -- there are no NULLs, so both count rows
+  SUM,   // exact for INT/BIGINT columns
+  AVG    // SUM / COUNT, computed when the view is read
+};
+
+// One output column of a view: a column of the base table or an aggregate over one.
+struct ViewColumn{
+  std::string name;               // header printed by SELECT, e.g. "Brand" or "SUM(Price)"
+  bool aggregate = false;
+  AggregateKind kind = AggregateKind::COUNT;
+  int column = -1;                // base-table column; -1 for COUNT(*)
+  bool exact = false;             // SUM/AVG over an INT or BIGINT column, summed as int64
+  };
+
+// The stored result of
+//   SELECT cols FROM table [WHERE ...]                          (a filtered projection)
+//   SELECT keys, COUNT(*), SUM(c), AVG(c) FROM table [WHERE ...] [GROUP BY keys]
+//
+// The base table calls rowInserted / rowDeleted for every change (an update is a
+// delete of the old version and an insert of the new one), so the view never
+// rescans the table after it is built. Projected rows are keyed by the base row's
+// primary key, which stays stable when the table is compacted or spilled to disk.
+// Reading the view visits only its own rows.
+class MaterializedView{
+public:
+  MaterializedView(std::string name, std::string select); // throws std::runtime_error on syntax errors
+
+  const std::string& name() const { return name_; }
+  const std::string& baseTable() const { return baseTable_; }
+  const std::string& definition() const { return select_; }
+  const std::vector<ViewColumn>& columns() const { return columns_; }
+
+  // Resolve the definition against 'base' and compute the view from scratch.
+  // Used when the view is created and when its base table is replaced (LOAD FROM).
+  void rebuild(const Table& base);
+
+  // Maintenance hooks, called by the base table while the row's partition is locked.
+  void rowInserted(const Table& base, const Row& row);
+  void rowDeleted(const Table& base, const Row& row);
+
+  void forEachRow(const std::function<void(const std::vector<Value>& values)>& visit) const;
+  size_t rowCount() const;
+
+private:
+  struct Group{
+    std::vector<Value> keys;      // values of the GROUP BY columns
+    size_t rows = 0;
+    std::vector<int64_t> intSums; // per output column, for SUM/AVG over INT and BIGINT
+    std::vector<double> sums;     // per output column, for SUM/AVG over FLOAT and DOUBLE
+    };
+  struct GroupKeyHash{
+    size_t operator()(const std::vector<Value>& keys) const noexcept;
+    };
+
+  void compile(const Table& base);
+  bool matches(const Table& base, const Row& row) const;
+  void add(const Table& base, const Row& row);    // caller holds mutex_, row matches the WHERE clause
+  void remove(const Table& base, const Row& row); // caller holds mutex_, row matches the WHERE clause
+  std::vector<Value> groupKeys(const Table& base, const Row& row) const;
+
+  std::string name_;
+  std::string select_;
+  std::string baseTable_;
+  std::vector<std::string> selectText_;   // items of the SELECT list, resolved by compile()
+  std::string whereText_;
+  std::vector<std::string> groupByText_;
+
+  std::vector<ViewColumn> columns_;
+  std::vector<int> groupBy_;               // base-table columns of the GROUP BY clause
+  bool aggregated_ = false;
+  std::unique_ptr<Predicate> predicate_;   // null without WHERE
+  int keyColumn_ = -1;                     // base table's primary key
+
+  mutable std::mutex mutex_;               // inserts into different partitions may report concurrently
+
+  // Projection views: one row per matching base row, removed by swapping with the last one.
+  std::vector<std::vector<Value>> rows_;
+  std::vector<Value> rowKeys_;             // primary key of the base row behind rows_[i]
+  std::unordered_map<Value, size_t> rowByKey_;
+
+  // Aggregate views: one group per distinct GROUP BY key (a single group without GROUP BY).
+  std::vector<Group> groups_;
+  std::unordered_map<std::vector<Value>, size_t, GroupKeyHash> groupByKey_;
+  };
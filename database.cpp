@@ -5,11 +5,33 @@
 #include <fmt/base.h>
 #include <fmt/format.h>
 #include "database.hpp" // use double quotes for the file.
+#include "View.hpp"     // materialized views are notified of every change
+#include "Executor.hpp" // long loads can be cancelled
 #include<vector>
 #include <stdexcept> // For std::runtime_error
 #include <fstream> // for file operations
 #include <string>
 #include <sstream>
+#include <filesystem> // for atomic rename of saved files
+#include <charconv>   // std::from_chars
+#include <algorithm>
+#include <atomic>
+#include <thread>     // parallel loading
+#include <exception>
+#include <cmath>
+#include <unordered_map>
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#include <process.h>   // _getpid
+#else
+#include <fcntl.h>     // open
+#include <unistd.h>    // fork, fsync, _exit
+#include <cstdio>      // fflush
+#include <sys/wait.h>  // waitpid
+#include <sys/mman.h>  // mmap for loading
+#include <sys/stat.h>  // fstat
+#endif
 
 // Converts a DataType enum to a readable string (used for debugging/errors).
 std::string dataTypeToString(DataType type) {
@@ -17,6 +39,8 @@ std::string dataTypeToString(DataType type) {
         case DataType::INT: return "INT";
         case DataType::FLOAT: return "FLOAT";
         case DataType::STRING: return "STRING";
+        case DataType::BIGINT: return "BIGINT";
+        case DataType::DOUBLE: return "DOUBLE";
         case DataType::BOOL:{
             return "BOOLEAN";
         }
@@ -24,29 +48,92 @@ std::string dataTypeToString(DataType type) {
     }
 }
 
-//Add a new column to the table and update existing rows with default values.
-void Table::addColumn(const std::string& columnName , DataType type) {
-    columns.push_back({columnName, type});
-    for (auto& row : rows) {
-        switch (type) {
-            case DataType::INT: {
-                row.values.push_back(0);
-                break;
-            }
-            case DataType::FLOAT: {
-                row.values.push_back(0.0f);
-                break;
-            }
-            case DataType::STRING: {
-                row.values.push_back("");
-                break;
-            }
-            case DataType::BOOL: {
-                row.values.push_back(false);
-                break;
+Value defaultValueFor(DataType type) {
+    switch (type) {
+        case DataType::INT: return 0;
+        case DataType::FLOAT: return 0.0f;
+        case DataType::STRING: return std::string_view();
+        case DataType::BOOL: return false;
+        case DataType::BIGINT: return Value::bigInt(0);
+        case DataType::DOUBLE: return Value::fromDouble(0.0);
+    }
+    return 0;
+}
+
+// Uses std::from_chars: no allocation, no locale, no exceptions on the hot path.
+// The whole token must be consumed, so "12abc" is rejected instead of read as 12.
+Value parseValue(std::string_view token, DataType type) {
+    switch (type) {
+        case DataType::INT: {
+            if (!token.empty() && token.front() == '+') token.remove_prefix(1);
+            int value = 0;
+            auto [ptr, ec] = std::from_chars(token.data(), token.data() + token.size(), value);
+            if (ec == std::errc() && ptr == token.data() + token.size() && !token.empty()) return value;
+            break;
+        }
+        case DataType::FLOAT: {
+            if (!token.empty() && token.front() == '+') token.remove_prefix(1);
+            float value = 0.0f;
+            auto [ptr, ec] = std::from_chars(token.data(), token.data() + token.size(), value);
+            if (ec == std::errc() && ptr == token.data() + token.size() && !token.empty()) return value;
+            break;
+        }
+        case DataType::BIGINT: {
+            if (!token.empty() && token.front() == '+') token.remove_prefix(1);
+            int64_t value = 0;
+            auto [ptr, ec] = std::from_chars(token.data(), token.data() + token.size(), value);
+            if (ec == std::errc() && ptr == token.data() + token.size() && !token.empty()) return Value::bigInt(value);
+            break;
+        }
+        case DataType::DOUBLE: {
+            if (!token.empty() && token.front() == '+') token.remove_prefix(1);
+            double value = 0.0;
+            auto [ptr, ec] = std::from_chars(token.data(), token.data() + token.size(), value);
+            if (ec == std::errc() && ptr == token.data() + token.size() && !token.empty()) return Value::fromDouble(value);
+            break;
+        }
+        case DataType::STRING: {
+            if (token.size() >= 2 && token.front() == '"' && token.back() == '"') {
+                token = token.substr(1, token.size() - 2);
             }
+            return Value(token);
+        }
+        case DataType::BOOL: {
+            if (token == "true" || token == "1") return true;
+            if (token == "false" || token == "0") return false;
+            break;
+        }
+    }
+    throw std::runtime_error("Invalid " + dataTypeToString(type) + " value: " + std::string(token));
+}
+
+//Add a new column with the zero value of its type as default.
+void Table::addColumn(const std::string& columnName , DataType type) {
+    addColumn(columnName, type, defaultValueFor(type));
+}
+
+// Add a new column without touching existing rows: only the schema changes.
+// Rows keep their shorter value list and read the default until they are next
+// written (UPDATE) or moved by compaction.
+void Table::addColumn(const std::string& columnName , DataType type, const Value& defaultValue) {
+    for (const auto& column : columns) {
+        if (column.name == columnName) {
+            throw std::runtime_error("Column already exists: " + columnName);
         }
     }
+    schemaVersion++;
+    columns.push_back({columnName, type, defaultValue, schemaVersion});
+}
+
+const Value& Table::valueAt(const Row& row, size_t columnIndex) const {
+    if (columnIndex < row.values.size()) return row.values[columnIndex];
+    return columns[columnIndex].defaultValue;
+}
+
+void Table::materialize(Row& row) const {
+    for (size_t i = row.values.size(); i < columns.size(); ++i) {
+        row.values.push_back(columns[i].defaultValue);
+    }
 }
 
 //Add a new row after checking value types
@@ -68,63 +155,627 @@ void Table::showTable() const {
     }
     fmt::print("\n");
     // Print rows
-    for (const auto& row : rows) {
-        for (const auto& value : row.values) {
-            std::visit([](const auto& v) { // std::visit is the correct way to acces value isnide a std::Variant.
-                fmt::print("{:<12}", v);  // print each value with padding
-            }, value);
+    for (size_t p = 0; p < partitions.size(); ++p) {
+        forEachRow(p, [&](size_t, const Row& row) {
+            for (size_t c = 0; c < columns.size(); ++c) {
+                fmt::print("{:<12}", valueAt(row, c));  // print each value with padding
+            }
+            fmt::print("\n");
+        });
+    }
+}
+
+Table::Table() {
+    partitions.push_back(std::make_unique<Partition>());
+}
+
+// Split the table into 'count' hash partitions on one column.
+// Only allowed while the table is empty, so no row ever has to move.
+void Table::partitionBy(size_t columnIndex, size_t count) {
+    if (columnIndex >= columns.size()) {
+        throw std::runtime_error("Partition column not found.");
+    }
+    if (count == 0 || count > maxPartitions) {
+        throw std::runtime_error("Partition count must be between 1 and " + std::to_string(maxPartitions) + ".");
+    }
+    if (rowCount() != 0) {
+        throw std::runtime_error("Only empty tables can be partitioned.");
+    }
+    partitions.clear();
+    for (size_t i = 0; i < count; ++i) {
+        partitions.push_back(std::make_unique<Partition>());
+    }
+    partitionColumn = static_cast<int>(columnIndex);
+}
+
+size_t Table::partitionFor(const Value& key) const {
+    return partitions.size() == 1 ? 0 : key.hash() % partitions.size();
+}
+
+int Table::primaryKeyIndex() const {
+    for (size_t i = 0; i < columns.size(); ++i) {
+        if (columns[i].name == primaryKeyColumn) {
+            return static_cast<int>(i);
         }
-        fmt::print("\n");
     }
+    return -1;
 }
+
 void Table::addRow(const std::vector<Value>& values) {
     if (values.size() != columns.size()) {
         throw std::runtime_error("Value count does not match column count.");
     }
+    insertRow(Row{values});
+}
 
-    // Find primary key column index
-    int pkIndex = -1;
-    for (size_t i = 0; i < columns.size(); ++i) {
-        if (columns[i].name == primaryKeyColumn) {
-            pkIndex = static_cast<int>(i);
-            break;
+void Table::addRow(std::vector<Value>&& values) {
+    if (values.size() != columns.size()) {
+        throw std::runtime_error("Value count does not match column count.");
+    }
+    insertRow(Row{std::move(values)});
+}
+
+static size_t containerBytes(const Partition& part);
+static size_t indexEntryBytes();
+
+// Route a row to its partition and check the primary key there.
+// When the partition key is the primary key (or there is one partition), a key can
+// only ever live in one partition, so only that partition's lock is needed and
+// concurrent inserts into other partitions proceed in parallel.
+void Table::insertRow(Row&& row) {
+    int pkIndex = primaryKeyIndex();
+    if (pkIndex == -1) {
+        throw std::runtime_error("Primary key column not found.");
+    }
+
+    // Get new row's PK value (deleted rows are not in the index, so their keys are free)
+    Value newPK = valueAt(row, pkIndex);
+    size_t target = partitionColumn >= 0 ? partitionFor(valueAt(row, partitionColumn)) : 0;
+    size_t bytes = estimateRowBytes(row.values);
+
+    std::unique_lock<std::mutex> targetLock;             // the common case, no allocation
+    std::vector<std::unique_lock<std::mutex>> allLocks;  // only when every partition must be checked
+    if (partitions.size() == 1 || partitionColumn == pkIndex) {
+        targetLock = std::unique_lock<std::mutex>(partitions[target]->mutex);
+        if (partitions[target]->primaryKeyIndex.contains(newPK)) {
+            throw std::runtime_error("Primary key violation: duplicate value in '" + primaryKeyColumn + "'");
+        }
+    } else {
+        // The key may already live in any partition. Locks are taken in index order, so two inserters cannot deadlock.
+        allLocks.reserve(partitions.size());
+        for (auto& part : partitions) {
+            allLocks.emplace_back(part->mutex);
+        }
+        for (auto& part : partitions) {
+            if (part->primaryKeyIndex.contains(newPK)) {
+                throw std::runtime_error("Primary key violation: duplicate value in '" + primaryKeyColumn + "'");
+            }
         }
     }
 
+    Partition& part = *partitions[target];
+    size_t containersBefore = containerBytes(part);
+    part.rows.push_back(std::move(row));
+    part.primaryKeyIndex.emplace(std::move(newPK), part.slotCount() - 1);
+    part.trackedBytes += bytes + indexEntryBytes() + (containerBytes(part) - containersBefore);
+    for (auto* view : views) view->rowInserted(*this, part.rows.back());
+}
+
+// Make room for 'needed' elements without giving up geometric growth,
+// so that many small batches do not reallocate (or rehash) on every call.
+static void reserveForBatch(std::vector<Row>& rows, size_t needed) {
+    if (needed > rows.capacity()) rows.reserve(std::max(needed, rows.capacity() * 2));
+}
+
+static void reserveForBatch(std::unordered_map<Value, size_t>& index, size_t needed) {
+    double room = static_cast<double>(index.bucket_count()) * index.max_load_factor();
+    if (static_cast<double>(needed) > room) index.reserve(std::max(needed, index.size() * 2));
+}
+
+size_t Table::appendRows(std::span<Row> batch) {
+    int pkIndex = primaryKeyIndex();
     if (pkIndex == -1) {
         throw std::runtime_error("Primary key column not found.");
     }
+    if (batch.empty()) return 0;
+
+    // Pass 1: widths and target partitions. Short rows are allowed only where the
+    // missing columns were added by ALTER TABLE (rows saved under an older schema).
+    std::vector<size_t> targets(batch.size());
+    std::vector<size_t> perPartition(partitions.size(), 0);
+    for (size_t i = 0; i < batch.size(); ++i) {
+        size_t width = batch[i].values.size();
+        if (width > columns.size() || (width < columns.size() && columns[width].addedInVersion == 0)) {
+            throw std::runtime_error("Value count does not match column count.");
+        }
+        targets[i] = partitionColumn >= 0 ? partitionFor(valueAt(batch[i], partitionColumn)) : 0;
+        perPartition[targets[i]]++;
+    }
+
+    std::vector<std::unique_lock<std::mutex>> locks;
+    std::vector<size_t> containersBefore;
+    locks.reserve(partitions.size());
+    containersBefore.reserve(partitions.size());
+    for (auto& part : partitions) {
+        locks.emplace_back(part->mutex);
+        containersBefore.push_back(containerBytes(*part));
+    }
+
+    // Pass 2: claim every key in its partition's index, pointing at the slot the row will get.
+    // Keys claimed earlier in the batch are in the indexes too, so in-batch duplicates are caught.
+    bool keyLivesInOnePartition = partitions.size() == 1 || partitionColumn == pkIndex;
+    std::vector<size_t> nextSlot(partitions.size());
+    for (size_t p = 0; p < partitions.size(); ++p) {
+        nextSlot[p] = partitions[p]->slotCount();
+        reserveForBatch(partitions[p]->primaryKeyIndex, partitions[p]->primaryKeyIndex.size() + perPartition[p]);
+    }
+    for (size_t i = 0; i < batch.size(); ++i) {
+        const Value& key = valueAt(batch[i], pkIndex);
+        bool duplicate = false;
+        if (keyLivesInOnePartition) {
+            duplicate = partitions[targets[i]]->primaryKeyIndex.contains(key);
+        } else {
+            for (auto& part : partitions) {
+                if (part->primaryKeyIndex.contains(key)) duplicate = true;
+            }
+        }
+        if (duplicate) {
+            // Give back the keys claimed so far; nothing else has been touched yet.
+            for (size_t j = 0; j < i; ++j) {
+                partitions[targets[j]]->primaryKeyIndex.erase(valueAt(batch[j], pkIndex));
+            }
+            throw std::runtime_error("Primary key violation: duplicate value in '" + primaryKeyColumn + "'");
+        }
+        partitions[targets[i]]->primaryKeyIndex.emplace(key, nextSlot[targets[i]]++);
+    }
+
+    // Pass 3: move the rows in.
+    for (size_t p = 0; p < partitions.size(); ++p) {
+        reserveForBatch(partitions[p]->rows, partitions[p]->rows.size() + perPartition[p]);
+    }
+    for (size_t i = 0; i < batch.size(); ++i) {
+        Partition& part = *partitions[targets[i]];
+        part.trackedBytes += estimateRowBytes(batch[i].values) + indexEntryBytes();
+        part.rows.push_back(std::move(batch[i]));
+        for (auto* view : views) view->rowInserted(*this, part.rows.back());
+    }
+    for (size_t p = 0; p < partitions.size(); ++p) {
+        partitions[p]->trackedBytes += containerBytes(*partitions[p]) - containersBefore[p];
+    }
+    return batch.size();
+}
 
-    // Get new row's PK value
-    const Value& newPK = values[pkIndex];
+bool Table::findByPrimaryKey(const Value& key, RowRef& found) const {
+    int pkIndex = primaryKeyIndex();
+    if (pkIndex == -1) return false;
+    for (size_t p = 0; p < partitions.size(); ++p) {
+        // Partitioned by the key itself: only one partition can hold it.
+        if (partitionColumn == pkIndex && p != partitionFor(key)) continue;
+        std::lock_guard<std::mutex> lock(partitions[p]->mutex);
+        auto it = partitions[p]->primaryKeyIndex.find(key);
+        if (it != partitions[p]->primaryKeyIndex.end()) {
+            found = {p, it->second};
+            return true;
+        }
+    }
+    return false;
+}
+
+// Write one cell. Old-schema rows are materialized first, the primary-key index
+// follows key changes, and a row whose partition key changes moves to its new partition.
+void Table::updateValue(RowRef ref, size_t columnIndex, const Value& value) {
+    int pkIndex = primaryKeyIndex();
+    Partition& part = *partitions[ref.partition];
+    if (valueAt(*rowAt(ref), columnIndex) == value) return;
 
-    // Check if any existing row has same PK value
-    for (const auto& row : rows) {
-        if (row.values.size() > pkIndex && row.values[pkIndex] == newPK) {
+    if (static_cast<int>(columnIndex) == pkIndex) {
+        RowRef existing;
+        if (findByPrimaryKey(value, existing)) {
             throw std::runtime_error("Primary key violation: duplicate value in '" + primaryKeyColumn + "'");
         }
     }
 
-    rows.push_back({values});
+    // Rows that change partition, and paged rows (which are immutable), get a new version.
+    bool changesPartition = static_cast<int>(columnIndex) == partitionColumn && partitionFor(value) != ref.partition;
+    if (changesPartition || ref.row < part.pagedRows) {
+        Row moved = *rowAt(ref);
+        materialize(moved);
+        moved.values[columnIndex] = value;
+        deleteRow(ref);
+        insertRow(std::move(moved));
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(part.mutex);
+    Row& row = part.rows[ref.row - part.pagedRows];
+    materialize(row); // writing an old-schema row brings it up to the current version
+    for (auto* view : views) view->rowDeleted(*this, row); // views see the old version leave...
+    if (static_cast<int>(columnIndex) == pkIndex) {
+        part.primaryKeyIndex.erase(row.values[columnIndex]);
+        part.primaryKeyIndex.emplace(value, ref.row);
+    }
+    row.values[columnIndex] = value;
+    for (auto* view : views) view->rowInserted(*this, row); // ...and the new one arrive
+}
+
+PinnedRow Table::rowAt(RowRef ref) const {
+    const Partition& part = *partitions[ref.partition];
+    if (ref.row >= part.pagedRows) return PinnedRow(part.rows[ref.row - part.pagedRows]);
+
+    // The run holding the slot: the last one starting at or before it.
+    auto run = std::upper_bound(part.pages.begin(), part.pages.end(), ref.row,
+        [](size_t slot, const PageInfo& info) { return slot < info.firstSlot; });
+    const PageInfo& info = *(run - 1);
+    std::shared_ptr<const Page> page = BufferPool::instance().fetch(*part.pageFile, info, false);
+    const Row& row = page->rows[ref.row - info.firstSlot];
+    return PinnedRow(row, std::move(page));
 }
 
+void Table::forEachRow(size_t partition, const std::function<void(size_t slot, const Row& row)>& visit) const {
+    constexpr size_t prefetchRuns = 8; // how far the OS is asked to read ahead of the scan
+    const Partition& part = *partitions[partition];
+    std::lock_guard<std::mutex> lock(part.mutex);
 
+    for (size_t i = 0; i < part.pages.size(); ++i) {
+        const PageInfo& info = part.pages[i];
+        if (i + 1 < part.pages.size()) {
+            const PageInfo& last = part.pages[std::min(i + prefetchRuns, part.pages.size() - 1)];
+            size_t from = part.pages[i + 1].firstPage;
+            part.pageFile->prefetch(from, last.firstPage + last.span - from);
+        }
+        std::shared_ptr<const Page> page = BufferPool::instance().fetch(*part.pageFile, info, true);
+        for (size_t r = 0; r < page->rows.size(); ++r) {
+            if (part.isDeleted(info.firstSlot + r)) continue;
+            visit(info.firstSlot + r, page->rows[r]);
+        }
+    }
 
-// Create a new table and add to database
-void Database::createTable(const std::string& tableName , const std::vector<Column>& columns) {
-    for (const auto& table : tables) {
-        if (table.name == tableName) {
-            throw std::runtime_error("Table already exists");
+    for (size_t r = 0; r < part.rows.size(); ++r) {
+        size_t slot = part.pagedRows + r;
+        if (part.isDeleted(slot)) continue;
+        visit(slot, part.rows[r]);
+    }
+}
+
+size_t Table::spill(const std::string& directory) {
+    static std::atomic<size_t> nextFile{0};
+    size_t written = 0;
+    for (size_t p = 0; p < partitions.size(); ++p) {
+        Partition& part = *partitions[p];
+        std::lock_guard<std::mutex> lock(part.mutex);
+        if (part.rows.empty()) continue;
+        if (!part.pageFile) {
+            std::string fileName = fmt::format("{}.p{}.{}.pages", name, p, nextFile++);
+            part.pageFile = std::make_unique<PageFile>((std::filesystem::path(directory) / fileName).string());
+        }
+
+        // The tail keeps its slot numbers, so the primary-key index stays valid as it is.
+        std::vector<bool> tailDeleted(part.rows.size(), false);
+        for (size_t r = 0; r < part.rows.size(); ++r) tailDeleted[r] = part.isDeleted(part.pagedRows + r);
+        std::vector<PageInfo> runs = writePages(*part.pageFile, part.rows, tailDeleted, part.pagedRows);
+        part.pages.insert(part.pages.end(), runs.begin(), runs.end());
+
+        written += part.rows.size();
+        part.pagedRows += part.rows.size();
+        part.pagedDeletedCount = part.deletedCount; // every tombstone is in a paged slot now
+        part.rows.clear();
+        part.rows.shrink_to_fit();
+        part.compacting = false; // the tail it was compacting is on disk now
+    }
+    resyncTrackedBytes();
+    return written;
+}
+
+size_t Table::pagedRowCount() const {
+    size_t count = 0;
+    for (const auto& part : partitions) count += part->pagedRows;
+    return count;
+}
+
+bool Table::isDeleted(RowRef ref) const {
+    return partitions[ref.partition]->isDeleted(ref.row);
+}
+
+void Table::deleteRow(RowRef ref) {
+    if (ref.partition >= partitions.size() || ref.row >= partitions[ref.partition]->slotCount()) {
+        throw std::runtime_error("Row index out of range.");
+    }
+    Partition& part = *partitions[ref.partition];
+    std::lock_guard<std::mutex> lock(part.mutex);
+    if (part.isDeleted(ref.row)) return;
+    if (part.deleted.size() < part.slotCount()) part.deleted.resize(part.slotCount(), false);
+    part.deleted[ref.row] = true;
+    part.deletedCount++;
+    if (ref.row < part.pagedRows) part.pagedDeletedCount++;
+
+    int pkIndex = primaryKeyIndex();
+    PinnedRow row = rowAt(ref);
+    if (pkIndex != -1) part.primaryKeyIndex.erase(valueAt(*row, pkIndex));
+    for (auto* view : views) view->rowDeleted(*this, *row);
+}
+
+void Table::undeleteRow(RowRef ref) {
+    Partition& part = *partitions[ref.partition];
+    std::lock_guard<std::mutex> lock(part.mutex);
+    if (!part.isDeleted(ref.row)) return;
+    part.deleted[ref.row] = false;
+    part.deletedCount--;
+    if (ref.row < part.pagedRows) part.pagedDeletedCount--;
+
+    int pkIndex = primaryKeyIndex();
+    PinnedRow row = rowAt(ref);
+    if (pkIndex != -1) part.primaryKeyIndex.emplace(valueAt(*row, pkIndex), ref.row);
+    for (auto* view : views) view->rowInserted(*this, *row);
+}
+
+void UndoLog::recordUpdate(const Value& keyAfter, size_t columnIndex, const Value& oldValue) {
+    entries_.push_back({{}, keyAfter, columnIndex, oldValue, false});
+}
+
+void UndoLog::recordDelete(RowRef ref) {
+    entries_.push_back({ref, {}, 0, {}, true});
+}
+
+size_t UndoLog::rollback() {
+    size_t restored = 0;
+    for (auto it = entries_.rbegin(); it != entries_.rend(); ++it) {
+        if (it->deleted) {
+            table_.undeleteRow(it->ref);
+        } else {
+            RowRef ref;
+            if (!table_.findByPrimaryKey(it->key, ref)) continue;
+            table_.updateValue(ref, it->columnIndex, it->oldValue);
+        }
+        restored++;
+    }
+    entries_.clear();
+    return restored;
+}
+
+size_t Table::rowCount() const {
+    size_t count = 0;
+    for (const auto& part : partitions) count += part->slotCount();
+    return count;
+}
+
+size_t Table::deletedRowCount() const {
+    size_t count = 0;
+    for (const auto& part : partitions) count += part->deletedCount;
+    return count;
+}
+
+size_t Table::liveRowCount() const {
+    return rowCount() - deletedRowCount();
+}
+
+bool Table::needsCompaction(double threshold) const {
+    for (const auto& part : partitions) {
+        if (part->compacting) return true;
+        // Only the in-memory tail is compacted; tombstones among paged rows stay until the table is saved and loaded again.
+        size_t tailDeleted = part->tailDeletedCount();
+        if (part->rows.empty() || tailDeleted == 0) continue;
+        if (static_cast<double>(tailDeleted) >= threshold * static_cast<double>(part->rows.size())) return true;
+    }
+    return false;
+}
+
+// Slide live rows of the in-memory tail towards its front, visiting at most 'budget' slots
+// per call. Cursors index 'rows'; slot numbers (tombstones, key index) are offset by pagedRows.
+// Slots in [compactWrite, compactRead) are always tombstones, so scans that run
+// between two steps still see every live row exactly once and in the original order.
+static bool compactPartition(Partition& part, const Table& table, int pkIndex, size_t budget) {
+    std::lock_guard<std::mutex> lock(part.mutex);
+    if (!part.compacting) {
+        part.compacting = true;
+        part.compactRead = 0;
+        part.compactWrite = 0;
+    }
+    const size_t firstSlot = part.pagedRows;
+    if (part.deleted.size() < part.slotCount()) part.deleted.resize(part.slotCount(), false);
+
+    size_t visited = 0;
+    while (part.compactRead < part.rows.size() && visited < budget) {
+        if (!part.deleted[firstSlot + part.compactRead]) {
+            Row& row = part.rows[part.compactRead];
+            table.materialize(row); // old-schema rows are brought up to date while we touch them anyway
+            if (part.compactRead != part.compactWrite) {
+                if (pkIndex != -1) part.primaryKeyIndex[row.values[pkIndex]] = firstSlot + part.compactWrite;
+                part.rows[part.compactWrite] = std::move(row);
+                part.deleted[firstSlot + part.compactWrite] = false;
+                part.deleted[firstSlot + part.compactRead] = true;
+            }
+            part.compactWrite++;
+        }
+        part.compactRead++;
+        visited++;
+    }
+
+    if (part.compactRead < part.rows.size()) return false;
+
+    // Everything from compactWrite onwards is dead: drop it and give the memory back.
+    // Rows below compactWrite that were deleted while the pass was running keep their
+    // tombstones; the next pass removes them. Paged tombstones are left as they are.
+    part.rows.resize(part.compactWrite);
+    part.deleted.resize(firstSlot + part.compactWrite);
+    part.deletedCount = static_cast<size_t>(std::count(part.deleted.begin(), part.deleted.end(), true));
+    if (part.deletedCount == 0) part.deleted.clear();
+    if (part.rows.capacity() > 2 * part.rows.size()) part.rows.shrink_to_fit();
+    part.compacting = false;
+    return true;
+}
+
+// One step of compaction for every partition that needs it; true once all are done.
+bool Table::compactStep(size_t budget) {
+    int pkIndex = primaryKeyIndex();
+    bool done = true;
+    for (auto& part : partitions) {
+        if (!part->compacting && part->tailDeletedCount() == 0) continue;
+        if (!compactPartition(*part, *this, pkIndex, budget)) done = false;
+    }
+    if (done) resyncTrackedBytes();
+    return done;
+}
+
+// Bytes malloc really hands out for a request of n bytes, minus n.
+static size_t mallocOverhead(size_t n) {
+    if (n == 0) return 0;
+    size_t chunk = std::max<size_t>(32, (n + 8 + 15) & ~static_cast<size_t>(15));
+    return chunk - n;
+}
+
+// Heap buffer owned by a std::string, or 0 if it fits in the small-string buffer.
+static size_t stringHeapBytes(const std::string& s) {
+    const char* object = reinterpret_cast<const char*>(&s);
+    bool inlineBuffer = s.data() >= object && s.data() < object + sizeof(std::string);
+    return inlineBuffer ? 0 : s.capacity() + 1;
+}
+
+// One node of a primary-key index: next pointer, key/slot pair and cached hash, plus its malloc chunk.
+static constexpr size_t indexNodeBytes = sizeof(void*) + sizeof(std::pair<const Value, size_t>) + sizeof(size_t);
+
+static size_t indexEntryBytes() {
+    return indexNodeBytes + mallocOverhead(indexNodeBytes);
+}
+
+// Buffers of a partition that grow geometrically: the row array and the index's bucket array.
+// Inserts charge the difference before and after, so reallocations count against the budget.
+static size_t containerBytes(const Partition& part) {
+    size_t rowBytes = part.rows.capacity() * sizeof(Row);
+    size_t bucketBytes = part.primaryKeyIndex.bucket_count() * sizeof(void*);
+    return rowBytes + mallocOverhead(rowBytes) + bucketBytes + mallocOverhead(bucketBytes);
+}
+
+size_t Table::insertBytes(const std::vector<Value>& values) const {
+    size_t target = partitionColumn >= 0 && static_cast<size_t>(partitionColumn) < values.size() ? partitionFor(values[partitionColumn]) : 0;
+    const Partition& part = *partitions[target];
+    std::lock_guard<std::mutex> lock(part.mutex);
+
+    size_t bytes = estimateRowBytes(values) + indexEntryBytes();
+    if (part.rows.size() == part.rows.capacity()) {
+        size_t grown = std::max<size_t>(1, 2 * part.rows.capacity()) * sizeof(Row); // geometric growth
+        size_t current = part.rows.capacity() * sizeof(Row);
+        bytes += grown + mallocOverhead(grown) - current - mallocOverhead(current);
+    }
+    if (static_cast<float>(part.primaryKeyIndex.size() + 1) > part.primaryKeyIndex.bucket_count() * part.primaryKeyIndex.max_load_factor()) {
+        bytes += part.primaryKeyIndex.bucket_count() * sizeof(void*); // the bucket array roughly doubles
+    }
+    return bytes;
+}
+
+size_t estimateRowBytes(const std::vector<Value>& values) {
+    // The stored copy is allocated with capacity == size.
+    size_t bytes = sizeof(Row) + values.size() * sizeof(Value) + mallocOverhead(values.size() * sizeof(Value));
+    for (const auto& value : values) {
+        size_t heap = value.heapBytes();
+        bytes += heap + mallocOverhead(heap);
+    }
+    return bytes;
+}
+
+// Add one partition's memory to 'stats' and return the bytes it accounts for.
+static size_t measurePartition(const Partition& part, size_t columnCount, TableMemoryStats& stats) {
+    size_t before = stats.rowOverheadBytes + stats.indexBytes + stats.allocatorOverheadBytes + stats.stringHeapBytes;
+    size_t cellBytes = 0;
+
+    stats.rowCount += part.slotCount();
+    stats.deletedRows += part.deletedCount;
+    stats.pagedRows += part.pagedRows;
+    stats.diskBytes += part.pageFile ? part.pageFile->pageCount() * pageSize : 0;
+    stats.rowOverheadBytes += sizeof(Partition) + part.rows.capacity() * sizeof(Row);
+    stats.allocatorOverheadBytes += mallocOverhead(sizeof(Partition)) + mallocOverhead(part.rows.capacity() * sizeof(Row));
+
+    for (const auto& row : part.rows) {
+        size_t valueBuffer = row.values.capacity() * sizeof(Value);
+        stats.rowOverheadBytes += (row.values.capacity() - row.values.size()) * sizeof(Value);
+        stats.allocatorOverheadBytes += mallocOverhead(valueBuffer);
+        for (size_t c = 0; c < row.values.size() && c < columnCount; ++c) {
+            size_t heap = row.values[c].heapBytes();
+            stats.columnBytes[c] += sizeof(Value);
+            cellBytes += sizeof(Value);
+            stats.stringHeapBytes += heap;
+            stats.allocatorOverheadBytes += mallocOverhead(heap);
         }
     }
+
+    // Tombstone bitmap, page directory and the primary-key hash index (bucket array and one node per key).
+    size_t bitmapBytes = (part.deleted.capacity() + 7) / 8 + part.pages.capacity() * sizeof(PageInfo);
+    size_t bucketBytes = part.primaryKeyIndex.bucket_count() * sizeof(void*);
+    stats.indexBytes += bitmapBytes + bucketBytes + part.primaryKeyIndex.size() * indexNodeBytes;
+    stats.allocatorOverheadBytes += mallocOverhead(bitmapBytes) + mallocOverhead(bucketBytes) +
+        part.primaryKeyIndex.size() * mallocOverhead(indexNodeBytes);
+
+    size_t after = stats.rowOverheadBytes + stats.indexBytes + stats.allocatorOverheadBytes + stats.stringHeapBytes;
+    return after - before + cellBytes;
+}
+
+TableMemoryStats Table::memoryStats() const {
+    TableMemoryStats stats;
+    stats.columnBytes.assign(columns.size(), 0);
+
+    stats.rowOverheadBytes = sizeof(Table) + partitions.capacity() * sizeof(std::unique_ptr<Partition>);
+    for (const auto& column : columns) {
+        stats.rowOverheadBytes += sizeof(Column) + stringHeapBytes(column.name) + column.defaultValue.heapBytes();
+    }
+
+    // String heap is reported separately and also attributed to its column.
+    for (const auto& part : partitions) {
+        std::lock_guard<std::mutex> lock(part->mutex);
+        measurePartition(*part, columns.size(), stats);
+        for (const auto& row : part->rows) {
+            for (size_t c = 0; c < row.values.size() && c < columns.size(); ++c) {
+                stats.columnBytes[c] += row.values[c].heapBytes();
+            }
+        }
+    }
+    stats.liveRows = stats.rowCount - stats.deletedRows;
+
+    stats.totalBytes = stats.rowOverheadBytes + stats.indexBytes + stats.allocatorOverheadBytes;
+    for (size_t bytes : stats.columnBytes) stats.totalBytes += bytes;
+    return stats;
+}
+
+size_t Table::trackedBytes() const {
+    size_t total = 0;
+    for (const auto& part : partitions) total += part->trackedBytes;
+    return total;
+}
+
+void Table::resyncTrackedBytes() {
+    for (auto& part : partitions) {
+        TableMemoryStats scratch;
+        scratch.columnBytes.assign(columns.size(), 0);
+        std::lock_guard<std::mutex> lock(part->mutex);
+        part->trackedBytes = measurePartition(*part, columns.size(), scratch);
+    }
+}
+
+
+
+// Create a new table and add to database
+Table& Database::createTable(std::string tableName, std::vector<Column> columns) {
     Table newTable;
-    newTable.name = tableName;
-    newTable.columns = columns;
-    tables.push_back(newTable);
+    newTable.name = std::move(tableName);
+    newTable.columns = std::move(columns);
+    return addTable(std::move(newTable));
+}
+
+Table& Database::addTable(Table&& table) {
+    if (getTable(table.name)) {
+        throw std::runtime_error("Table already exists");
+    }
+    if (getView(table.name)) {
+        throw std::runtime_error("A materialized view with this name already exists");
+    }
+    return tables.emplace_back(std::move(table));
 }
 
 // Drop a table by name
 void Database::dropTable(const std::string& tableName) {
+    for (const auto& view : views) {
+        if (view->baseTable() == tableName) {
+            throw std::runtime_error("Materialized view '" + view->name() + "' depends on it; drop the view first");
+        }
+    }
     for (auto it = tables.begin(); it != tables.end(); it++) {
         if (it->name == tableName) {
             tables.erase(it);// delete the table by the given name.
@@ -134,8 +785,180 @@ void Database::dropTable(const std::string& tableName) {
     throw std::runtime_error("Table does not exist");
 }
 
+MaterializedView& Database::createView(std::string viewName, std::string select) {
+    if (getTable(viewName) || getView(viewName)) {
+        throw std::runtime_error("A table or view named '" + viewName + "' already exists");
+    }
+    auto view = std::make_unique<MaterializedView>(std::move(viewName), std::move(select));
+    Table* base = getTable(view->baseTable());
+    if (!base) throw std::runtime_error("Table not found: " + view->baseTable());
+    view->rebuild(*base);
+    base->views.push_back(view.get());
+    return *views.emplace_back(std::move(view));
+}
+
+void Database::dropView(const std::string& viewName) {
+    for (auto it = views.begin(); it != views.end(); ++it) {
+        if ((*it)->name() != viewName) continue;
+        if (Table* base = getTable((*it)->baseTable())) {
+            std::erase(base->views, it->get());
+        }
+        views.erase(it);
+        return;
+    }
+    throw std::runtime_error("View does not exist");
+}
+
+MaterializedView* Database::getView(std::string_view viewName) {
+    for (auto& view : views) {
+        if (view->name() == viewName) return view.get();
+    }
+    return nullptr;
+}
+
+// A replaced table starts without views: recompute the ones defined over it and
+// hook them up again. A view that no longer fits the new schema is dropped.
+void Database::attachViews(Table& table) {
+    table.views.clear();
+    std::string dropped;
+    for (auto it = views.begin(); it != views.end();) {
+        if ((*it)->baseTable() != table.name) {
+            ++it;
+            continue;
+        }
+        try {
+            (*it)->rebuild(table);
+            table.views.push_back(it->get());
+            ++it;
+        } catch (const std::exception& e) {
+            dropped += (dropped.empty() ? "" : " ") + ("Materialized view '" + (*it)->name() + "' dropped: " + e.what());
+            it = views.erase(it);
+        }
+    }
+    if (!dropped.empty()) throw std::runtime_error(dropped);
+}
+
+size_t Database::memoryUsage() const {
+    size_t total = 0;
+    for (const auto& table : tables) {
+        total += table.trackedBytes();
+    }
+    return total;
+}
+
+// Make room for an insert of 'extraBytes' under the memory budget.
+// Tables with tombstones are compacted to completion first; only if that is
+// not enough is the insert rejected, long before the process would be OOM-killed.
+void Database::ensureMemoryFor(size_t extraBytes) {
+    if (memoryBudget == 0 || memoryUsage() + extraBytes <= memoryBudget) return;
+
+    for (auto& table : tables) {
+        if (table.needsCompaction(0.0)) {
+            while (table.needsCompaction(0.0)) table.compactStep(table.rowCount() + 1);
+        } else {
+            table.resyncTrackedBytes();
+        }
+    }
+
+    // Still too much: move the in-memory rows of the largest tables to disk.
+    while (memoryUsage() + extraBytes > memoryBudget) {
+        Table* largest = nullptr;
+        for (auto& table : tables) {
+            bool hasRows = false;
+            for (const auto& part : table.partitions) hasRows = hasRows || !part->rows.empty();
+            if (hasRows && (!largest || table.trackedBytes() > largest->trackedBytes())) largest = &table;
+        }
+        if (!largest) break;
+        largest->spill(spillPath());
+    }
+
+    size_t used = memoryUsage();
+    if (used + extraBytes > memoryBudget) {
+        throw std::runtime_error("Memory budget exceeded: " + std::to_string(used) + " of " +
+            std::to_string(memoryBudget) + " bytes in use");
+    }
+}
+
+// Collect statistics from an evenly spaced sample of at most 1024 live rows.
+// The number of distinct values is extrapolated with the GEE estimator:
+// sqrt(n / sample) * (values seen once) + (values seen more than once).
+void Table::analyze() const {
+    constexpr size_t maxSample = 1024;
+    size_t live = liveRowCount();
+    size_t stride = std::max<size_t>(1, rowCount() / maxSample);
+
+    columnStats.assign(columns.size(), ColumnStats{});
+    for (size_t c = 0; c < columns.size(); ++c) {
+        ColumnStats& stats = columnStats[c];
+        std::unordered_map<Value, size_t> seen;
+        size_t sampled = 0, trues = 0;
+        bool first = true;
+
+        for (size_t p = 0; p < partitions.size(); ++p) {
+            for (size_t r = 0; r < partitions[p]->slotCount(); r += stride) {
+                if (partitions[p]->isDeleted(r)) continue;
+                PinnedRow row = rowAt({p, r}); // paged rows fault in only the sampled pages
+                const Value& value = valueAt(*row, c);
+                seen[value]++;
+                sampled++;
+
+                double number = value.toNumber();
+                if (value.type() == DataType::BOOL && value.asBool()) trues++;
+                if (first || number < stats.minValue) stats.minValue = number;
+                if (first || number > stats.maxValue) stats.maxValue = number;
+                first = false;
+            }
+        }
+
+        if (sampled == 0) continue;
+        size_t once = 0;
+        for (const auto& [value, count] : seen) {
+            if (count == 1) once++;
+        }
+        double estimate = std::sqrt(static_cast<double>(live) / sampled) * once + (seen.size() - once);
+        stats.distinctCount = std::clamp(estimate, 1.0, static_cast<double>(std::max<size_t>(live, 1)));
+        stats.trueFraction = static_cast<double>(trues) / sampled;
+    }
+    statsRowCount = live;
+}
+
+// Statistics are re-collected when the schema changed or the live row count
+// moved by more than 20% since the last analyze().
+const std::vector<ColumnStats>& Table::statistics() const {
+    size_t live = liveRowCount();
+    size_t drift = live > statsRowCount ? live - statsRowCount : statsRowCount - live;
+    if (columnStats.size() != columns.size() || drift * 5 > statsRowCount) {
+        analyze();
+    }
+    return columnStats;
+}
+
+// Called by the command loop after every command. Each table gets a bounded slice of
+// compaction work, so a large DELETE never turns into one long stall.
+// Finished snapshots are reaped and a periodic snapshot is started when it is due.
+void Database::runMaintenance(size_t budget) {
+    for (auto& table : tables) {
+        if (table.needsCompaction(compactionThreshold)) {
+            table.compactStep(budget);
+        }
+    }
+
+    pollSnapshot();
+    if (!autoSnapshotPath.empty() && autoSnapshotSeconds > 0 && snapshotPid == -1) {
+        auto now = std::chrono::steady_clock::now();
+        if (now - lastAutoSnapshot >= std::chrono::seconds(autoSnapshotSeconds)) {
+            lastAutoSnapshot = now;
+            try {
+                saveToFileAsync(autoSnapshotPath);
+            } catch (const std::exception& e) {
+                fmt::print(" Auto snapshot failed: {}\n", e.what());
+            }
+        }
+    }
+}
+
 // Get a pointer to a table by name
-Table* Database::getTable(const std::string& tableName) {
+Table* Database::getTable(std::string_view tableName) {
     for (auto& table : tables) {
         if (table.name == tableName) {
             return &table;
@@ -145,9 +968,50 @@ Table* Database::getTable(const std::string& tableName) {
 }
 
 
-// Save to a file
+// Flush a written file to stable storage before it is renamed into place.
+static void syncFile(const std::string& path) {
+#ifdef _WIN32
+    int fd = _open(path.c_str(), _O_RDWR);
+    if (fd == -1) throw std::runtime_error("Could not reopen file for sync: " + path);
+    int rc = _commit(fd);
+    _close(fd);
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd == -1) throw std::runtime_error("Could not reopen file for sync: " + path);
+    int rc = ::fsync(fd);
+    ::close(fd);
+#endif
+    if (rc != 0) throw std::runtime_error("fsync failed for: " + path);
+}
+
+// Write one value in the text format: strings in quotes, bools as true/false, numbers as-is.
+// Doubles use the shortest representation that reads back to the same value.
+static void writeValue(std::ostream& file, const Value& value) {
+    if (value.isString()) {
+        file << '"' << value.asString() << '"';
+    } else {
+        file << value.toString();
+    }
+}
+
+static int currentProcessId() {
+#ifdef _WIN32
+    return _getpid();
+#else
+    return ::getpid();
+#endif
+}
+
+// Save to a file.
+// The data goes to a temporary file next to 'path' first, is fsynced and then renamed
+// over 'path', so a crash leaves either the old file or the complete new one, never half
+// of it. The temporary name is unique per process and save, so a background snapshot
+// and another save of the same file never write into each other's temporary file.
 void Database::saveToFile(const std::string& path) const {
-    std::ofstream file(path);
+    static std::atomic<unsigned> saveCounter{0};
+    const std::string tmpPath = path + "." + std::to_string(currentProcessId()) + "." +
+        std::to_string(saveCounter.fetch_add(1)) + ".tmp";
+    std::ofstream file(tmpPath, std::ios::trunc);
     if (!file.is_open()) {
         throw std::runtime_error("Could not open file for writing: " + path);
     }
@@ -160,126 +1024,413 @@ void Database::saveToFile(const std::string& path) const {
         for (size_t i = 0; i < table.columns.size(); ++i) {
             const auto& col = table.columns[i];
             file << " " << col.name << " " << dataTypeToString(col.type);
+            if (col.addedInVersion > 0) {
+                // Rows saved before this column existed are written short and load back with this default.
+                file << " DEFAULT ";
+                writeValue(file, col.defaultValue);
+            }
             if (i < table.columns.size() - 1) file << ",";
         }
         file << "\n";
 
-        // Write rows
-        for (const auto& row : table.rows) {
-            file << "ROW:";
-            // Loop through each value in the row and write it to the file
-            // Use std::visit to handle each type in the variant safely
-            for (size_t i = 0; i < row.values.size(); ++i) {
-                std::visit([&file](const auto& val) {
-                    if constexpr (std::is_same_v<decltype(val), std::string>)
-                        file << " \"" << val << "\""; // wrap strings in quotes
-                    else if constexpr (std::is_same_v<decltype(val), bool>)
-                        file << " " << (val ? "true" : "false"); // convert bools to text
-                    else
-                        file << " " << val; // write numbers directly
-                }, row.values[i]);
-
-                if (i < row.values.size() - 1) file << ",";
-            }
-            file << "\n";
+        if (table.partitionColumn >= 0) {
+            file << "PARTITION BY HASH(" << table.columns[table.partitionColumn].name << ") INTO "
+                 << table.partitions.size() << "\n";
+        }
+
+        // Write rows (tombstoned rows are not persisted)
+        for (size_t p = 0; p < table.partitions.size(); ++p) {
+            table.forEachRow(p, [&](size_t, const Row& row) {
+                file << "ROW:";
+                // Loop through each value in the row and write it to the file
+                for (size_t i = 0; i < row.values.size(); ++i) {
+                    file << " ";
+                    writeValue(file, row.values[i]);
+
+                    if (i < row.values.size() - 1) file << ",";
+                }
+                file << "\n";
+            });
         }
 
         file << "END_TABLE\n";
     }
 
     file.close();
+    if (file.fail()) {
+        std::filesystem::remove(tmpPath);
+        throw std::runtime_error("Write failed for: " + path);
+    }
+    syncFile(tmpPath);
+    std::filesystem::rename(tmpPath, path); // atomic replace on POSIX
+#ifndef _WIN32
+    // Persist the rename itself by syncing the containing directory.
+    std::filesystem::path dir = std::filesystem::path(path).parent_path();
+    int dirFd = ::open(dir.empty() ? "." : dir.c_str(), O_RDONLY);
+    if (dirFd != -1) {
+        ::fsync(dirFd);
+        ::close(dirFd);
+    }
+#endif
 }
 
+static std::filesystem::path temporarySpillPath() {
+    return std::filesystem::temp_directory_path() / ("cql-spill-" + std::to_string(currentProcessId()));
+}
 
-void Database::loadFromFile(const std::string& path) {
-    std::ifstream file(path);
-    if (!file.is_open()) {
-        throw std::runtime_error("Could not open file for reading: " + path);
-    }
+std::string Database::spillPath() {
+    std::filesystem::path dir = spillDirectory.empty() ? temporarySpillPath() : std::filesystem::path(spillDirectory);
+    std::filesystem::create_directories(dir);
+    return dir.string();
+}
 
-    tables.clear(); // Reset current database
-    std::string line;
-    Table currentTable;
-    //read the file line-by-line and handle each table/row/column based on keywords.
-    while (std::getline(file, line)) {
-        if (line.starts_with("TABLE ")) {
-            currentTable = Table();
-            currentTable.name = line.substr(6); // get table name
-        }
-        else if (line.starts_with("COLUMNS:")) {
-            currentTable.columns.clear();
-            std::string cols = line.substr(8);
-            std::istringstream ss(cols);
-            std::string token;
-
-            // Split a line by commas, extracting one token at a time (e.g., column definitions or values).
-            while (std::getline(ss, token, ',')) {
-                std::istringstream pairStream(token);
-                std::string name, typeStr;
-                pairStream >> name >> typeStr;
-
-                DataType type;
-                if (typeStr == "INT") type = DataType::INT;
-                else if (typeStr == "FLOAT") type = DataType::FLOAT;
-                else if (typeStr == "STRING") type = DataType::STRING;
-                else if (typeStr == "BOOL" || typeStr == "BOOLEAN") type = DataType::BOOL;
-                else throw std::runtime_error("Unknown column type: " + typeStr);
-
-                currentTable.columns.push_back({name, type});
-            }
+Database::~Database() {
+    tables.clear(); // each PageFile deletes its file
+    std::error_code ignored;
+    std::filesystem::remove(temporarySpillPath(), ignored); // only succeeds if it is empty
+}
+
+// Start a snapshot in the background.
+// On POSIX the database is forked: the child sees a copy-on-write, point-in-time
+// image of memory and writes it with saveToFile, while the parent returns to the
+// command loop immediately. Windows has no fork, so the save happens synchronously.
+void Database::saveToFileAsync(const std::string& path) {
+    pollSnapshot();
+    if (snapshotPid != -1) {
+        throw std::runtime_error("A snapshot to '" + snapshotPath + "' is still running");
+    }
+#ifdef _WIN32
+    saveToFile(path);
+#else
+    std::fflush(stdout); // do not let the child inherit unflushed console output
+    pid_t pid = ::fork();
+    if (pid == -1) {
+        throw std::runtime_error("Could not start background snapshot (fork failed)");
+    }
+    if (pid == 0) {
+        int status = 0;
+        try {
+            saveToFile(path);
+        } catch (const std::exception& e) {
+            std::cerr << " Snapshot error: " << e.what() << "\n"; // the parent only sees the exit status
+            status = 1;
+        } catch (...) {
+            std::cerr << " Snapshot error: unknown exception\n";
+            status = 1;
         }
-        else if (line.starts_with("ROW:")) {
-            std::vector<Value> rowValues;
-            std::string rowData = line.substr(4);
-            std::istringstream valStream(rowData);
-            std::string token;
-            size_t colIndex = 0;
+        ::_exit(status); // skip destructors and atexit handlers of the parent's state
+    }
+    snapshotPid = pid;
+    snapshotPath = path;
+#endif
+}
 
-            // Split the row line by commas to get each value string.
-            // Then remove any leading/trailing whitespace from the token
-            while (std::getline(valStream, token, ',')) {
-                token.erase(0, token.find_first_not_of(" \t")); // remove leading whitespaces.
-                token.erase(token.find_last_not_of(" \t") + 1);    // remove trailing whitespaces.
+bool Database::pollSnapshot() {
+#ifndef _WIN32
+    if (snapshotPid == -1) return false;
+    int status = 0;
+    pid_t done = ::waitpid(snapshotPid, &status, WNOHANG);
+    if (done == 0) return false; // still writing
+    if (done == snapshotPid && WIFEXITED(status) && WEXITSTATUS(status) == 0) {
+        fmt::print(" Snapshot saved to '{}'.\n", snapshotPath);
+    } else {
+        fmt::print(" Snapshot to '{}' failed.\n", snapshotPath);
+    }
+    snapshotPid = -1;
+    return true;
+#else
+    return false;
+#endif
+}
 
-                if (colIndex >= currentTable.columns.size()) {
-                    throw std::runtime_error("Too many values in a row for table " + currentTable.name);
-                }
+void Database::waitForSnapshot() {
+#ifndef _WIN32
+    if (snapshotPid == -1) return;
+    int status = 0;
+    ::waitpid(snapshotPid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        fmt::print(" Snapshot to '{}' failed.\n", snapshotPath);
+    }
+    snapshotPid = -1;
+#endif
+}
+
+
+// Remove leading/trailing spaces and tabs without copying.
+static std::string_view trimView(std::string_view text) {
+    size_t first = text.find_first_not_of(" \t\r");
+    if (first == std::string_view::npos) return {};
+    size_t last = text.find_last_not_of(" \t\r");
+    return text.substr(first, last - first + 1);
+}
+
+// Position of the comma that ends the first field of 'text', skipping commas inside
+// quoted strings, or npos if the field runs to the end. Used for ROW: and COLUMNS: lines.
+static size_t findFieldEnd(std::string_view text) {
+    size_t pos = 0;
+    while (true) {
+        pos = text.find_first_of(",\"", pos);
+        if (pos == std::string_view::npos || text[pos] == ',') return pos;
+        size_t closingQuote = text.find('"', pos + 1);
+        if (closingQuote == std::string_view::npos) return std::string_view::npos;
+        pos = closingQuote + 1;
+    }
+}
+
+DataType parseDataType(std::string_view typeStr) {
+    if (typeStr == "INT") return DataType::INT;
+    if (typeStr == "BIGINT") return DataType::BIGINT;
+    if (typeStr == "FLOAT") return DataType::FLOAT;
+    if (typeStr == "DOUBLE") return DataType::DOUBLE;
+    if (typeStr == "STRING") return DataType::STRING;
+    if (typeStr == "BOOL" || typeStr == "BOOLEAN") return DataType::BOOL;
+    throw std::runtime_error("Unknown column type: " + std::string(typeStr));
+}
+
+// Parse one "TABLE ... END_TABLE" section of a saved file.
+// Sections are independent, so loadFromFile runs several of these at once.
+// With a non-zero 'spillAbove', rows are moved to page files in 'spillDirectory' whenever
+// the table's memory estimate exceeds it, so tables larger than the budget can be loaded.
+static Table parseTableSection(std::string_view section, const std::string& spillDirectory, size_t spillAbove) {
+    Table table;
+
+    // Every line after TABLE and COLUMNS is a row, so the line count is a good reserve hint.
+    size_t lineCount = static_cast<size_t>(std::count(section.begin(), section.end(), '\n'));
+    if (spillAbove == 0) table.partitions[0]->rows.reserve(lineCount);
+    table.partitions[0]->primaryKeyIndex.reserve(lineCount);
+
+    // Parsed rows are staged and moved into the table in batches.
+    constexpr size_t batchRows = 4096;
+    std::vector<Row> pending;
+    pending.reserve(std::min(lineCount, batchRows));
 
-                DataType type = currentTable.columns[colIndex].type;
+    size_t pos = 0;
+    while (pos < section.size()) {
+        size_t eol = section.find('\n', pos);
+        if (eol == std::string_view::npos) eol = section.size();
+        std::string_view line = section.substr(pos, eol - pos);
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+        pos = eol + 1;
 
+        if (line.starts_with("ROW:")) {
+            Row row;
+            row.values.reserve(table.columns.size());
+            std::string_view rest = line.substr(4);
+            size_t colIndex = 0;
+
+            // Split the row line by commas outside quotes, trimming each value.
+            while (true) {
+                size_t comma = findFieldEnd(rest);
+                std::string_view token = trimView(rest.substr(0, comma));
+
+                if (colIndex >= table.columns.size()) {
+                    throw std::runtime_error("Too many values in a row for table " + table.name);
+                }
                 try {
-                    if (type == DataType::INT) {
-                        rowValues.push_back(std::stoi(token));
-                    } else if (type == DataType::FLOAT) {
-                        rowValues.push_back(std::stof(token));
-                    } else if (type == DataType::STRING) {
-                        if (token.front() == '"' && token.back() == '"') {
-                            token = token.substr(1, token.size() - 2);
-                        }
-                        rowValues.push_back(token);
-                    } else if (type == DataType::BOOL) {
-                        if (token == "true" || token == "1") rowValues.push_back(true);
-                        else if (token == "false" || token == "0") rowValues.push_back(false);
-                        else throw std::runtime_error("Invalid BOOL value: " + token);
-                    }
+                    row.values.push_back(parseValue(token, table.columns[colIndex].type));
                 } catch (...) {
-                    throw std::runtime_error("Value conversion failed for: '" + token +
-                        "' in column " + currentTable.columns[colIndex].name);
+                    throw std::runtime_error("Value conversion failed for: '" + std::string(token) +
+                        "' in column " + table.columns[colIndex].name);
                 }
-
                 colIndex++;
+
+                if (comma == std::string_view::npos) break;
+                rest.remove_prefix(comma + 1);
             }
 
-            if (colIndex != currentTable.columns.size()) {
-                throw std::runtime_error("Row value count does not match column count in table " + currentTable.name);
+            // Rows from an older schema version may stop before the ALTERed columns.
+            if (colIndex < table.columns.size() && table.columns[colIndex].addedInVersion == 0) {
+                throw std::runtime_error("Row value count does not match column count in table " + table.name);
             }
 
-            currentTable.rows.push_back({rowValues});
+            pending.push_back(std::move(row));
+            if (pending.size() == batchRows) {
+                CancellationToken::current().check(); // the database is only replaced once every section is parsed
+                table.appendRows(pending);
+                pending.clear();
+                if (spillAbove > 0 && table.trackedBytes() > spillAbove) table.spill(spillDirectory);
+            }
         }
-        else if (line == "END_TABLE") {
-            tables.push_back(currentTable);
+        else if (line.starts_with("PARTITION BY HASH(")) {
+            // "PARTITION BY HASH(col) INTO n", always written before the first ROW
+            size_t close = line.find(')');
+            size_t into = line.find("INTO", close == std::string_view::npos ? 0 : close);
+            if (close == std::string_view::npos || into == std::string_view::npos) {
+                throw std::runtime_error("Malformed PARTITION line in table " + table.name);
+            }
+            std::string_view column = trimView(line.substr(18, close - 18));
+            size_t count = 0;
+            std::string_view countText = trimView(line.substr(into + 4));
+            std::from_chars(countText.data(), countText.data() + countText.size(), count);
+
+            size_t columnIndex = table.columns.size();
+            for (size_t i = 0; i < table.columns.size(); ++i) {
+                if (table.columns[i].name == column) columnIndex = i;
+            }
+            table.partitionBy(columnIndex, count);
+            for (auto& part : table.partitions) {
+                if (spillAbove == 0) part->rows.reserve(lineCount / count + 1);
+                part->primaryKeyIndex.reserve(lineCount / count + 1);
+            }
+        }
+        else if (line.starts_with("TABLE ")) {
+            table.name = std::string(line.substr(6)); // get table name
+        }
+        else if (line.starts_with("COLUMNS:")) {
+            table.columns.clear();
+            std::string_view rest = line.substr(8);
+
+            // Each column is "Name TYPE" or, for ALTERed columns, "Name TYPE DEFAULT value".
+            while (!rest.empty()) {
+                size_t comma = findFieldEnd(rest); // a quoted DEFAULT may contain commas
+                std::string_view token = trimView(rest.substr(0, comma));
+                rest = comma == std::string_view::npos ? std::string_view() : rest.substr(comma + 1);
+
+                size_t nameEnd = token.find_first_of(" \t");
+                std::string_view name = token.substr(0, nameEnd);
+                std::string_view typeAndDefault = nameEnd == std::string_view::npos ? std::string_view() : trimView(token.substr(nameEnd));
+                size_t typeEnd = typeAndDefault.find_first_of(" \t");
+                DataType type = parseDataType(typeAndDefault.substr(0, typeEnd));
+                std::string_view tail = typeEnd == std::string_view::npos ? std::string_view() : trimView(typeAndDefault.substr(typeEnd));
+
+                if (tail.starts_with("DEFAULT")) {
+                    // Column added by ALTER TABLE: each one is a new schema version.
+                    table.schemaVersion++;
+                    table.columns.push_back({std::string(name), type, parseValue(trimView(tail.substr(7)), type), table.schemaVersion});
+                } else {
+                    table.columns.push_back({std::string(name), type, defaultValueFor(type), 0});
+                }
+            }
         }
     }
 
-    file.close();
-}
\ No newline at end of file
+    table.appendRows(pending);
+    table.resyncTrackedBytes();
+    return table;
+}
+
+// Read-only view of a whole file. On POSIX the file is memory-mapped, so the OS
+// pages it in as the parser advances and can drop pages already parsed, instead of
+// the file being copied into one buffer up front.
+class FileImage{
+public:
+  explicit FileImage(const std::string& path) {
+#ifndef _WIN32
+      int fd = ::open(path.c_str(), O_RDONLY);
+      if (fd == -1) throw std::runtime_error("Could not open file for reading: " + path);
+      struct stat info{};
+      if (::fstat(fd, &info) == 0 && info.st_size > 0) {
+          void* mapped = ::mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+          if (mapped != MAP_FAILED) {
+              ::madvise(mapped, static_cast<size_t>(info.st_size), MADV_SEQUENTIAL);
+              data_ = static_cast<const char*>(mapped);
+              size_ = static_cast<size_t>(info.st_size);
+          }
+      }
+      ::close(fd);
+      if (data_) return;
+#endif
+      std::ifstream file(path, std::ios::binary | std::ios::ate);
+      if (!file.is_open()) {
+          throw std::runtime_error("Could not open file for reading: " + path);
+      }
+      buffer_.resize(static_cast<size_t>(file.tellg()));
+      file.seekg(0);
+      file.read(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+  }
+  FileImage(const FileImage&) = delete;
+  FileImage& operator=(const FileImage&) = delete;
+  ~FileImage() {
+#ifndef _WIN32
+      if (data_) ::munmap(const_cast<char*>(data_), size_);
+#endif
+  }
+
+  std::string_view view() const { return data_ ? std::string_view(data_, size_) : std::string_view(buffer_); }
+
+private:
+  const char* data_ = nullptr; // mapped file
+  size_t size_ = 0;
+  std::string buffer_;         // fallback copy
+  };
+
+// Load a saved database.
+// The file is mapped (or read in one bulk read), split into TABLE sections, and the
+// sections are parsed on a small pool of threads. Under a memory budget, tables spill
+// rows to page files while they load. The current tables are only replaced once the
+// whole file parsed successfully.
+void Database::loadFromFile(const std::string& path) {
+    FileImage image(path);
+
+    // Find the sections. A TABLE without END_TABLE is ignored, as before.
+    std::vector<std::string_view> sections;
+    std::string_view content = image.view();
+    size_t pos = 0;
+    size_t sectionStart = std::string_view::npos;
+    while (pos < content.size()) {
+        size_t eol = content.find('\n', pos);
+        if (eol == std::string_view::npos) eol = content.size();
+        std::string_view line = content.substr(pos, eol - pos);
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+
+        if (line.starts_with("TABLE ")) {
+            sectionStart = pos;
+        } else if (line == "END_TABLE" && sectionStart != std::string_view::npos) {
+            sections.push_back(content.substr(sectionStart, pos - sectionStart));
+            sectionStart = std::string_view::npos;
+        }
+        pos = eol + 1;
+    }
+
+    // Under a memory budget, each table may keep a share of it in memory and spills the rest.
+    std::string spillDirectory = memoryBudget > 0 ? spillPath() : std::string();
+    size_t spillAbove = memoryBudget > 0 ? std::max<size_t>(1, memoryBudget / (2 * std::max<size_t>(1, sections.size()))) : 0;
+
+    std::vector<Table> loaded(sections.size());
+    std::vector<std::exception_ptr> errors(sections.size());
+    std::atomic<size_t> next{0};
+    auto worker = [&]() {
+        for (size_t i = next++; i < sections.size(); i = next++) {
+            try {
+                loaded[i] = parseTableSection(sections[i], spillDirectory, spillAbove);
+            } catch (...) {
+                errors[i] = std::current_exception();
+            }
+        }
+    };
+
+    size_t threadCount = std::min<size_t>(sections.size(), std::max(1u, std::thread::hardware_concurrency()));
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < threadCount; ++i) {
+        threads.emplace_back(worker);
+    }
+    worker(); // the calling thread parses too
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    for (const auto& error : errors) {
+        if (error) std::rethrow_exception(error); // report the first bad section in file order
+    }
+
+    tables = std::move(loaded);
+
+    // Views follow their base tables: rebuilt from the loaded rows, or dropped if the table is gone.
+    std::string problems;
+    for (auto it = views.begin(); it != views.end();) {
+        if (getTable((*it)->baseTable())) {
+            ++it;
+            continue;
+        }
+        problems += (problems.empty() ? "" : " ") + ("Materialized view '" + (*it)->name() + "' dropped: table '" + (*it)->baseTable() + "' is not in the file.");
+        it = views.erase(it);
+    }
+    for (auto& table : tables) {
+        try {
+            attachViews(table);
+        } catch (const std::exception& e) {
+            problems += (problems.empty() ? "" : " ") + std::string(e.what());
+        }
+    }
+    if (!problems.empty()) throw std::runtime_error(problems);
+}
@@ -5,61 +5,252 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <vector>
-#include <variant>  // for storing multiple possible types in one variable.
+#include <chrono>   // for periodic snapshots
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <unordered_map>
+#include "Value.hpp" // DataType and the 16-byte Value every cell is stored as
+#include "Storage.hpp" // page files and the buffer pool for tables that live partly on disk
 
-// representing supported datatypes in the database.
-enum class DataType{
-
-  INT,
-  FLOAT,
-  STRING,
-  BOOL
-  };
-
-// Define a type that can store any value of the supported data types.
-// std::variant ensures type safety and avoids void pointers.
-using Value = std::variant<int , float , std::string, bool>;
+class MaterializedView; // View.hpp
 
 // A single column in a table, defined by a name and data type.
+// Columns added by ALTER TABLE also remember the schema version that introduced
+// them and the value that older rows report for them.
 struct Column{
   std::string name;
   DataType type;
+  Value defaultValue;      // returned for rows written before this column existed
+  int addedInVersion = 0;  // 0 for columns created with the table
   };
 
 // A row in a table -- contains a list of values (one per column)
-// Each value is stored using std::variant, typed safely.
+// Each value is a 16-byte tagged Value (see Value.hpp).
+// Rows written under an older schema are shorter than the column list: the number
+// of values is the row's schema version, missing trailing values come from the defaults.
 struct Row{
   std::vector<Value> values; // row data, each entry corresponds to a column.
   };
 
 
+// Sampled statistics of one column, used to order WHERE predicates by selectivity.
+struct ColumnStats{
+  double minValue = 0.0;      // numeric columns only
+  double maxValue = 0.0;      // numeric columns only
+  double distinctCount = 1.0; // estimated number of distinct values
+  double trueFraction = 0.5;  // BOOL columns only
+  };
+
+// Memory used by one table, as reported by SHOW STATS.
+// Heap sizes are exact; allocator overhead is an estimate based on a
+// glibc-style malloc (8-byte header, 16-byte granularity, 32-byte minimum chunk).
+struct TableMemoryStats{
+  size_t rowCount = 0;             // rows stored, including tombstoned ones
+  size_t liveRows = 0;
+  size_t deletedRows = 0;
+  std::vector<size_t> columnBytes; // per column: Value cells stored + their string heap
+  size_t stringHeapBytes = 0;      // heap buffers of strings too long to be stored inline in a Value
+  size_t rowOverheadBytes = 0;     // Row objects, unused vector capacity, table metadata
+  size_t indexBytes = 0;           // auxiliary structures (primary-key indexes, tombstone bitmaps)
+  size_t allocatorOverheadBytes = 0;
+  size_t totalBytes = 0;           // memory only; paged rows are counted below
+  size_t pagedRows = 0;            // rows (and slots of deleted rows) living in page files
+  size_t diskBytes = 0;            // size of the page files
+  };
+
+// Identifies one stored row: the partition it lives in and its slot there.
+struct RowRef{
+  size_t partition = 0;
+  size_t row = 0;
+  };
+
+constexpr size_t maxPartitions = 1024; // upper bound for PARTITION BY HASH(...) INTO n
+
+// One hash partition of a table.
+// Every partition has its own rows, tombstones, primary-key index and lock, so
+// inserts into different partitions never wait for each other.
+// Tables created without PARTITION BY have exactly one partition.
+//
+// Rows are addressed by slot. After a spill, slots [0, pagedRows) live in pages on
+// disk and are read through the buffer pool; the in-memory 'rows' hold the slots after them.
+// Paged rows are never modified in place: an UPDATE tombstones them and appends the new version.
+struct Partition{
+  std::vector<Row> rows;       // Actual data : in-memory rows, slot pagedRows + i is rows[i]
+  std::vector<bool> deleted;   // Tombstones: deleted[slot] == true means the row was removed by DELETE.
+  size_t deletedCount = 0;     // number of tombstoned rows still occupying a slot
+  size_t pagedDeletedCount = 0; // of those, the ones in paged slots: only SAVE TO + LOAD FROM reclaims them
+  std::unordered_map<Value, size_t> primaryKeyIndex; // live primary key -> slot in 'rows'
+  size_t trackedBytes = 0;     // running estimate of the memory footprint, used by the memory budget
+  mutable std::mutex mutex;    // taken by inserts, updates, deletes and scans of this partition
+
+  // Compaction cursors, as indexes into 'rows': only the in-memory tail is compacted.
+  // Compaction runs in small steps between commands, so a reader never waits for a
+  // full rewrite. Between steps the partition stays consistent: every moved-from slot is tombstoned.
+  bool compacting = false;
+  size_t compactRead = 0;
+  size_t compactWrite = 0;
+
+  std::unique_ptr<PageFile> pageFile; // on-disk part, null until the partition is first spilled
+  std::vector<PageInfo> pages;         // runs of paged rows, in slot order
+  size_t pagedRows = 0;
+
+  bool isDeleted(size_t index) const { return index < deleted.size() && deleted[index]; }
+  size_t slotCount() const { return pagedRows + rows.size(); }
+  size_t tailDeletedCount() const { return deletedCount - pagedDeletedCount; } // tombstones compaction can reclaim
+  };
+
+// Read access to one row that stays valid while the handle lives.
+// In-memory rows are referenced directly; a paged row keeps its page pinned in the buffer pool.
+class PinnedRow{
+public:
+  PinnedRow(const Row& row, std::shared_ptr<const Page> page = nullptr) : row_(&row), page_(std::move(page)) {}
+  const Row& operator*() const { return *row_; }
+  const Row* operator->() const { return row_; }
+
+private:
+  const Row* row_;
+  std::shared_ptr<const Page> page_;
+  };
+
 // A table structure, containing:
 // - Name of the table
 // - List of columns defining schema
-// - List of rows storing actual data.
+// - Hash partitions holding the rows (one partition unless PARTITION BY HASH was used)
 struct Table{
   std::string name; // table name ( e.g students.)
   std::vector<Column> columns; // Schema : (list of columns)
-  std::vector<Row> rows;       // Actual data : list of rows
+  std::vector<std::unique_ptr<Partition>> partitions; // Actual data, never empty
+  int partitionColumn = -1;    // column whose hash picks the partition, -1 if not partitioned
   std::string primaryKeyColumn = "ID";
-  void addColumn(const std::string& columnName , DataType type); // add a new column to the table
-  void addRow(const std::vector<Value>& values);    // add a new row to the table, with type-checked values.
+  int schemaVersion = 0;       // bumped by every ALTER TABLE ... ADD
+  std::vector<MaterializedView*> views; // owned by the Database; told about every inserted, updated and deleted row
+
+  // Column statistics are collected from a sample and refreshed once the table has changed enough.
+  mutable std::vector<ColumnStats> columnStats;
+  mutable size_t statsRowCount = 0; // live rows when the statistics were collected
+
+  Table();                                  // starts with a single partition
+
+  void partitionBy(size_t columnIndex, size_t count); // PARTITION BY HASH(column) INTO count, empty tables only
+  size_t partitionFor(const Value& key) const;        // partition a partition-key value hashes to
+  int primaryKeyIndex() const;              // index of primaryKeyColumn, or -1
+
+  void addColumn(const std::string& columnName , DataType type); // add a new column to the table (zero default)
+  void addColumn(const std::string& columnName , DataType type, const Value& defaultValue); // metadata-only, O(1)
+  // Add a new row to the table, with type-checked values. Safe to call from several
+  // threads at once: only the target partition is locked when the table is
+  // partitioned by its primary key (otherwise all partitions are, for the key check).
+  void addRow(const std::vector<Value>& values);
+  void addRow(std::vector<Value>&& values);  // same, but the values are moved into the table
+  void insertRow(Row&& row);                // store a row (may be from an older schema) and index its key
+  // Move a batch of rows into the table. The batch is validated first (row widths, primary keys
+  // against the table and within the batch), so either all rows are added or none are.
+  // Capacity is reserved and the partition locks are taken once for the whole batch.
+  size_t appendRows(std::span<Row> batch);
   void showTable() const;
+
+  PinnedRow rowAt(RowRef ref) const;       // point lookup: faults in at most one page
+  // Visit the live rows of one partition in slot order, holding its lock. Paged rows are read
+  // page by page, with the following pages prefetched, and do not displace hot pages in the pool.
+  void forEachRow(size_t partition, const std::function<void(size_t slot, const Row& row)>& visit) const;
+  // Move the in-memory rows of every partition to page files in 'directory'. Slots and the
+  // primary-key index stay as they are. Returns the number of rows written.
+  size_t spill(const std::string& directory);
+  size_t pagedRowCount() const;
+  const Value& valueAt(const Row& row, size_t columnIndex) const; // read a cell, falling back to the column default
+  void materialize(Row& row) const;         // append defaults so the row matches the current schema
+  void updateValue(RowRef ref, size_t columnIndex, const Value& value); // keeps key index and partitioning correct
+  bool findByPrimaryKey(const Value& key, RowRef& found) const;        // O(1) index probe
+
+  bool isDeleted(RowRef ref) const;         // true if the row is a tombstone
+  void deleteRow(RowRef ref);               // mark a row as deleted (O(1), no shifting) and free its key
+  void undeleteRow(RowRef ref);             // undo deleteRow: clear the tombstone and index the key again
+  size_t rowCount() const;                  // stored rows, including tombstones
+  size_t deletedRowCount() const;
+  size_t liveRowCount() const;              // rows that are not tombstoned
+  bool needsCompaction(double threshold) const; // true if the dead fraction of a partition reached the threshold
+  bool compactStep(size_t budget);          // move up to 'budget' slots, returns true when compaction finished
+
+  TableMemoryStats memoryStats() const;     // walk the table and measure its memory (O(rows))
+  size_t trackedBytes() const;              // sum of the partitions' running estimates
+  size_t insertBytes(const std::vector<Value>& values) const; // what inserting this row adds to trackedBytes()
+  void resyncTrackedBytes();                // replace the running estimates with measured values
+
+  void analyze() const;                     // (re)collect column statistics from a sample of rows
+  const std::vector<ColumnStats>& statistics() const; // current statistics, re-analyzed when stale
   };
 
 
 
 
+// Undo information of one UPDATE or DELETE, so a statement that fails or is cancelled
+// halfway leaves its table as it was. Rollback undoes the entries in reverse order.
+// Updated rows are found again by primary key, because updating a paged row or a
+// partition key moves the row to a new slot.
+class UndoLog{
+public:
+  explicit UndoLog(Table& table) : table_(table) {}
+
+  void recordUpdate(const Value& keyAfter, size_t columnIndex, const Value& oldValue);
+  void recordDelete(RowRef ref);
+  size_t rollback();                        // returns the number of rows restored
+
+private:
+  struct Entry{
+    RowRef ref;          // deleted row
+    Value key;           // updated row: its primary key after the update
+    size_t columnIndex = 0;
+    Value oldValue;
+    bool deleted = false;
+    };
+
+  Table& table_;
+  std::vector<Entry> entries_;
+  };
+
 // A database is collection of tables.
 struct Database{
   std::vector<Table> tables; // List of all tables in the database
+  std::vector<std::unique_ptr<MaterializedView>> views; // CREATE MATERIALIZED VIEW, maintained by their base tables
+  double compactionThreshold = 0.25; // compact a table once this fraction of its rows is deleted
+
+  // Background snapshots: a forked child writes a point-in-time copy while commands keep running.
+  int snapshotPid = -1;              // child process writing the current snapshot, -1 if none
+  std::string snapshotPath;          // target file of the running snapshot
+  std::string autoSnapshotPath;      // periodic snapshots go here (empty = disabled)
+  int autoSnapshotSeconds = 0;       // interval between periodic snapshots
+  std::chrono::steady_clock::time_point lastAutoSnapshot;
 
-  void createTable(const std::string& tableName , const std::vector<Column>& columns);// Create a new table with the given name and columns
+  size_t memoryBudget = 0;           // bytes all tables may use together, 0 = unlimited
+  std::string spillDirectory;        // page files of spilled tables, a temp directory if empty
+  std::chrono::milliseconds statementTimeout{0}; // SET statement_timeout, 0 = no limit
+
+  Database() = default;
+  Database(const Database&) = delete;
+  Database& operator=(const Database&) = delete;
+  ~Database();                                 // removes the page files and the temporary spill directory
+  Table& createTable(std::string tableName, std::vector<Column> columns); // Create a new table; name and columns are moved in
+  Table& addTable(Table&& table);              // Adopt a fully built table (e.g. loaded from a file) without copying its rows
   void dropTable(const std::string& tableName); // Remove a table by name
-  void saveToFile(const std::string& path) const;
-  void loadFromFile(const std::string &path);
-  Table* getTable(const std::string& tableName); // Get a pointer to a table by name, or nullptr if not found.
+  void saveToFile(const std::string& path) const; // crash-safe: temp file, fsync, atomic rename
+  void saveToFileAsync(const std::string& path);  // start a background snapshot and return immediately
+  bool pollSnapshot();                            // reap a finished snapshot, true if one just completed
+  void waitForSnapshot();                         // block until the running snapshot (if any) is done
+  void loadFromFile(const std::string &path); // TABLE sections are parsed in parallel
+  Table* getTable(std::string_view tableName); // Get a pointer to a table by name, or nullptr if not found.
+  void runMaintenance(size_t budget = 4096); // Background work between commands (compaction, snapshots).
+  size_t memoryUsage() const;                // sum of the tables' tracked footprints
+  void ensureMemoryFor(size_t extraBytes);   // compact, then spill to disk, throw if the budget would still be exceeded
+  std::string spillPath();                   // directory for page files, created on first use
+
+  MaterializedView& createView(std::string viewName, std::string select); // build it once, then maintain it incrementally
+  void dropView(const std::string& viewName);
+  MaterializedView* getView(std::string_view viewName);
+  void attachViews(Table& table);            // rebuild the views over a table that was replaced (e.g. by LOAD FROM)
 
   };
 
@@ -67,6 +258,21 @@ struct Database{
 // Example: DataType::INT -> "INT"
 std::string dataTypeToString(DataType type);
 
+// Parse a type name (INT, BIGINT, FLOAT, DOUBLE, STRING, BOOL/BOOLEAN), case-sensitive.
+// Throws std::runtime_error for unknown names.
+DataType parseDataType(std::string_view typeStr);
+
+// Zero value of a type: 0, 0.0, "" or false.
+Value defaultValueFor(DataType type);
+
+// Estimated memory of a row's own allocations (Row, value buffer, string heap) once stored in a table.
+// Table::insertBytes adds the primary-key index entry and container growth on top.
+size_t estimateRowBytes(const std::vector<Value>& values);
+
+// Parse a literal (e.g. 42, 3.5, "text", true) as a value of the given column type.
+// Throws std::runtime_error if the text does not match the type.
+Value parseValue(std::string_view token, DataType type);
+
 
 
 
@@ -3,11 +3,19 @@
 //
 
 #include <iostream>
+#include "Value.cpp"
+#include "Storage.cpp"
+#include "Executor.cpp"
 #include "database.cpp"
+#include "Predicate.cpp"
+#include "View.cpp"
+#include "Export.cpp"
 #include "CommandParser.cpp"
 
 int main() {
     Database db;
+    StatementExecutor executor; // statements run on its worker thread, so they can be timed out or cancelled
+    StatementExecutor::installInterruptHandler();
     std::string input;
 
     fmt::print("Welcome to CQL. Type command below:\n");
@@ -21,6 +29,8 @@ int main() {
             fmt::print("Do you want to save before exiting? (yes/no): ");
             std::getline(std::cin, choice);
 
+            db.waitForSnapshot(); // let a background snapshot finish before saving again or exiting
+
             if (choice == "yes" || choice == "y") {
                 std::string path;
                 fmt::print("Enter filename (e.g. save.txt): ");
@@ -38,7 +48,12 @@ int main() {
             break;
         }
 
-        CommandParser::executeCommand(input, db);
+        try {
+            executor.run([&] { CommandParser::executeCommand(input, db); }, db.statementTimeout);
+        } catch (const std::exception& e) {
+            std::cerr << " " << e.what() << "\n"; // e.g. a SELECT cancelled while printing
+        }
+        db.runMaintenance(); // incremental compaction, background snapshot bookkeeping
     }
 
     return 0;
@@ -50,6 +65,8 @@ int main() {
 
 // Create the Cars table
 // CREATE_TABLE Cars(ID INT,Brand STRING , Horsepower INT , Price FLOAT , Type STRING , Electric BOOL);
+// Or split it into hash partitions on the key
+// CREATE_TABLE Cars(ID INT,Brand STRING , Horsepower INT , Price FLOAT , Type STRING , Electric BOOL) PARTITION BY HASH(ID) INTO 4;
 // Add a new column for Color
 // ALTER TABLE Cars ADD Color STRING;
 
@@ -70,6 +87,10 @@ int main() {
 // UPDATE Cars SET Electric = true WHERE Brand == "BMW";
 // UPDATE Cars SET Color = "Red" WHERE Brand == "Toyota";
 
+// Delete a record (tombstoned, space is reclaimed by background compaction)
+// DELETE FROM Cars WHERE Brand == "Toyota";
+// SET compaction_threshold = 0.25;
+
 
 // DQL - Data Query Language
 // Used to query and view data
@@ -86,13 +107,38 @@ int main() {
 // SELECT * FROM Cars WHERE Type == "SUV";
 
 // SELECT * FROM Cars WHERE Color == "Red";
+// SELECT Brand, Price FROM Cars WHERE Horsepower > 300 AND (Type == "SUV" OR NOT Electric == false);
+
+// Give up on statements that take longer than two seconds (Ctrl-C cancels one at any time)
+// SET statement_timeout = 2000;
+
+// Several queries, one pass over the table
+// BATCH SELECT Brand FROM Cars WHERE Price > 50000; SELECT Brand, Price FROM Cars WHERE Electric == true;
+
+// Keep a query result up to date instead of rescanning the table
+// CREATE MATERIALIZED VIEW BrandPrices AS SELECT Brand, COUNT(*), AVG(Price) FROM Cars GROUP BY Brand;
+// SELECT * FROM BrandPrices;
+// DROP VIEW BrandPrices;
 
 // Save to a file
 // SAVE TO "cars.txt";
 
+// Snapshot in the background / every 5 minutes
+// SAVE TO "cars.txt" ASYNC;
+// SAVE TO "cars_auto.txt" EVERY 300;
+
+// Export a query result / load it back without parsing
+// SELECT Brand, Price FROM Cars WHERE Price > 50000 INTO "expensive.csv" FORMAT CSV;
+// SELECT * FROM Cars WHERE Electric == true INTO "electric.col" FORMAT COLUMNAR;
+// COPY ElectricCars FROM "electric.col";
+
 // Load from file
 // LOAD_FROM "cars.txt";
 
+// Keep a large table on disk, reading it through the buffer pool
+// SET buffer_pool = 16MB;
+// SPILL TABLE Cars;
+
 
 
 // TESTING EDGE CASES.